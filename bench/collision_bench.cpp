@@ -0,0 +1,287 @@
+// Collision benchmark: runs the collision step of ControlledScene3D (broadphase,
+// narrowphase and dispatch) on a generated scene, without a window or a GL context,
+// and prints the results as JSON so they can be compared between engine changes.
+// Cannonballs are destroyed and fired again like in the game, and the allocations
+// that takes are counted too.
+//
+// usage: collision_bench [--tanks N] [--buildings M] [--cannonballs K] [--map-size S]
+//                        [--frames F] [--warmup W] [--threads T] [--seed X]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "main/wisteria_engine/gameobject3d.h"
+#include "main/wisteria_engine/collisionworld3d.h"
+#include "main/wisteria_engine/narrowphase3d.h"
+#include "main/game/helpers.h"
+
+#define FRAME_TIME (1.0f / 60.0f)
+#define CELL_SIZE 8.0f
+#define TANK_RADIUS 1.5f
+#define TANK_SPEED 5.0f
+#define TANK_ANGULAR_SPEED 90.0f
+#define CANNONBALL_RADIUS 1.0f
+#define CANNONBALL_SPEED 15.0f
+#define GRAVITY -9.81f
+
+using namespace engine;
+
+// every allocation goes through here, so the collision step can be checked for
+// allocations in the steady state
+static std::atomic<size_t> allocationCount(0);
+
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size != 0 ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+
+struct Options {
+    int tanks = 3;
+    int buildings = 20;
+    int cannonballs = 10;
+    float mapSize = 100;
+    int frames = 600;
+    int warmup = 60;
+    int threads = 0;
+    unsigned seed = 1;
+};
+
+static Options ParseOptions(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            exit(1);
+        }
+        const char *value = argv[++i];
+        if (arg == "--tanks") options.tanks = std::atoi(value);
+        else if (arg == "--buildings") options.buildings = std::atoi(value);
+        else if (arg == "--cannonballs") options.cannonballs = std::atoi(value);
+        else if (arg == "--map-size") options.mapSize = (float)std::atof(value);
+        else if (arg == "--frames") options.frames = std::atoi(value);
+        else if (arg == "--warmup") options.warmup = std::atoi(value);
+        else if (arg == "--threads") options.threads = std::atoi(value);
+        else if (arg == "--seed") options.seed = (unsigned)std::atoi(value);
+        else {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            exit(1);
+        }
+    }
+    return options;
+}
+
+// the same kind of scene as the game: lock walls around the map, static buildings
+// of all sizes, tanks driving around at random and cannonballs flying between them
+class BenchScene
+{
+public:
+    BenchScene(const Options &options)
+        : options(options), random(options.seed), narrowphase(options.threads)
+    {
+        collisionMasks.assign(32, 0);
+        collisionMasks[LAYER_TANKS] = (1 << LAYER_BUILDINGS) | (1 << LAYER_TANKS) | (1 << LAYER_CANNONBALLS);
+        collisionMasks[LAYER_BUILDINGS] = (1 << LAYER_TANKS) | (1 << LAYER_CANNONBALLS);
+        collisionMasks[LAYER_CANNONBALLS] = (1 << LAYER_BUILDINGS) | (1 << LAYER_TANKS);
+        float mapSize = options.mapSize;
+        world.grid.SetBounds(glm::vec2(-mapSize - 2), glm::vec2(mapSize + 2), CELL_SIZE);
+
+        AddStatic(glm::vec3(0, 0, mapSize + 1), glm::vec3(2 * mapSize, 1, 2));
+        AddStatic(glm::vec3(0, 0, -mapSize - 1), glm::vec3(2 * mapSize, 1, 2));
+        AddStatic(glm::vec3(mapSize + 1, 0, 0), glm::vec3(2, 1, 2 * mapSize));
+        AddStatic(glm::vec3(-mapSize - 1, 0, 0), glm::vec3(2, 1, 2 * mapSize));
+        for (int i = 0; i < options.buildings; ++i) {
+            float minScale = i % 2 == 0 ? 15.0f : 1.0f;
+            float maxScale = i % 2 == 0 ? 30.0f : 10.0f;
+            glm::vec3 scale = glm::vec3(Uniform(minScale, maxScale), Uniform(minScale, maxScale),
+                                        Uniform(minScale, maxScale));
+            AddStatic(RandomPosition(), scale);
+        }
+
+        for (int i = 0; i < options.tanks; ++i) {
+            // like the game, tanks don't start inside buildings
+            glm::vec3 position = RandomPosition();
+            for (int tries = 0; tries < 20; ++tries) {
+                overlaps.clear();
+                world.OverlapSphere(position + glm::vec3(0, 1, 0), TANK_RADIUS, overlaps);
+                if (overlaps.empty())
+                    break;
+                position = RandomPosition();
+            }
+            GameObject *tank = new GameObject(position);
+            tank->Rotate(glm::angleAxis(Uniform(0, glm::two_pi<float>()), glm::vec3_up));
+            tank->SetSphereHitArea(TANK_RADIUS, glm::vec3(0, 1, 0));
+            world.SetLayerMask(tank, 1u << LAYER_TANKS);
+            tanks.push_back(tank);
+        }
+        for (int i = 0; i < options.cannonballs; ++i)
+            cannonballs.push_back(Fire());
+    }
+
+    // moves everything like a frame of the game would, outside of the measured step
+    void Simulate()
+    {
+        world.BeginStep();
+        for (auto tank : tanks) {
+            if (Uniform(0, 1) < 0.5f)
+                tank->Translate(tank->GetForward() * TANK_SPEED * FRAME_TIME);
+            else
+                tank->Rotate(glm::angleAxis(glm::radians(TANK_ANGULAR_SPEED * FRAME_TIME), glm::vec3_up));
+        }
+        for (auto &cannonball : cannonballs) {
+            cannonball->velocity.y += GRAVITY * FRAME_TIME;
+            cannonball->Translate(cannonball->velocity * FRAME_TIME);
+            if (cannonball->GetPosition().y < 0) {
+                // like the game, which destroys it and fires a new one
+                size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+                Destroy(cannonball);
+                cannonball = Fire();
+                spawnAllocations += allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+                ++spawns;
+            }
+        }
+    }
+
+    // the collision step of ControlledScene3D::CheckCollisions
+    void CheckCollisions()
+    {
+        GameObject::UpdateTransforms();
+
+        collisionPairs.clear();
+        world.FindPairs(collisionMasks, collisionPairs);
+        narrowphase.Run(collisionPairs, contacts);
+        for (auto &contact : contacts) {
+            world.Wake(contact.gameObject1);
+            world.Wake(contact.gameObject2);
+        }
+        for (auto &contact : contacts)
+            contact.Dispatch();
+    }
+
+    size_t PairCount() const { return collisionPairs.size(); }
+    size_t ContactCount() const { return contacts.size(); }
+    int ThreadCount() const { return narrowphase.GetThreadCount(); }
+
+    size_t spawns = 0;
+    size_t spawnAllocations = 0;
+
+private:
+    float Uniform(float min, float max)
+    {
+        return std::uniform_real_distribution<float>(min, max)(random);
+    }
+
+    glm::vec3 RandomPosition()
+    {
+        return glm::vec3(Uniform(-options.mapSize, options.mapSize), 0,
+                         Uniform(-options.mapSize, options.mapSize));
+    }
+
+    void AddStatic(glm::vec3 position, glm::vec3 scale)
+    {
+        GameObject *building = new GameObject(position, scale);
+        building->SetBoxHitArea(1, 1, 1, glm::vec3(0, 0.5f, 0));
+        building->bodyType = BODY_STATIC;
+        world.SetLayerMask(building, 1u << LAYER_BUILDINGS);
+    }
+
+    GameObject *Fire()
+    {
+        GameObject *tank = tanks.empty() ? nullptr : tanks[random() % tanks.size()];
+        glm::vec3 origin = tank ? tank->GetPosition() + glm::vec3(0, 2, 0) : RandomPosition();
+        float angle = Uniform(0, glm::two_pi<float>());
+        glm::vec3 direction = glm::normalize(glm::vec3(glm::cos(angle), Uniform(0, 0.5f), glm::sin(angle)));
+
+        GameObject *cannonball = new GameObject(origin);
+        cannonball->SetTag("Cannonball");
+        cannonball->velocity = direction * CANNONBALL_SPEED;
+        cannonball->SetSphereHitArea(CANNONBALL_RADIUS);
+        cannonball->continuousCollision = true;
+        world.SetLayerMask(cannonball, 1u << LAYER_CANNONBALLS);
+        return cannonball;
+    }
+
+    // like ControlledScene3D::Destroy, which deletes the children too
+    void Destroy(GameObject *gameObject)
+    {
+        while (!gameObject->GetChildren().empty())
+            Destroy(gameObject->GetChildren().back());
+        delete gameObject;
+    }
+
+    Options options;
+    std::mt19937 random;
+    CollisionWorld world;
+    std::vector<int> collisionMasks;
+    std::vector<GameObject *> tanks, cannonballs;
+    std::vector<GameObject *> overlaps;
+
+    ParallelNarrowphase narrowphase;
+    std::vector<std::pair<GameObject *, GameObject *>> collisionPairs;
+    std::vector<Contact> contacts;
+};
+
+int main(int argc, char **argv)
+{
+    Options options = ParseOptions(argc, argv);
+    BenchScene scene(options);
+
+    for (int frame = 0; frame < options.warmup; ++frame) {
+        scene.Simulate();
+        scene.CheckCollisions();
+    }
+
+    scene.spawns = scene.spawnAllocations = 0;
+    size_t pairs = 0, contacts = 0, allocations = 0;
+    std::chrono::nanoseconds elapsed(0);
+    for (int frame = 0; frame < options.frames; ++frame) {
+        scene.Simulate();
+
+        size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        scene.CheckCollisions();
+        elapsed += std::chrono::steady_clock::now() - start;
+        allocations += allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+        pairs += scene.PairCount();
+        contacts += scene.ContactCount();
+    }
+
+    double frames = options.frames > 0 ? options.frames : 1;
+    double nanoseconds = (double)elapsed.count();
+    std::printf("{\n");
+    std::printf("  \"tanks\": %d,\n", options.tanks);
+    std::printf("  \"buildings\": %d,\n", options.buildings);
+    std::printf("  \"cannonballs\": %d,\n", options.cannonballs);
+    std::printf("  \"map_size\": %g,\n", options.mapSize);
+    std::printf("  \"frames\": %d,\n", options.frames);
+    std::printf("  \"threads\": %d,\n", scene.ThreadCount());
+    std::printf("  \"sphere_box_kernel\": \"%s\",\n", SphereBoxBatch::KernelName());
+    std::printf("  \"pairs_tested\": %zu,\n", pairs);
+    std::printf("  \"contacts_found\": %zu,\n", contacts);
+    std::printf("  \"pairs_per_frame\": %.2f,\n", pairs / frames);
+    std::printf("  \"contacts_per_frame\": %.2f,\n", contacts / frames);
+    std::printf("  \"ns_per_pair\": %.2f,\n", pairs > 0 ? nanoseconds / pairs : 0.0);
+    std::printf("  \"us_per_frame\": %.2f,\n", nanoseconds / frames / 1000.0);
+    std::printf("  \"allocs_per_frame\": %.2f,\n", allocations / frames);
+    std::printf("  \"spawns\": %zu,\n", scene.spawns);
+    std::printf("  \"allocs_per_spawn\": %.2f,\n",
+                scene.spawns > 0 ? scene.spawnAllocations / (double)scene.spawns : 0.0);
+    std::printf("  \"gameobject_slabs\": %zu,\n", GameObject::GetAllocatorStats().slabs);
+    std::printf("  \"hitarea_slabs\": %zu\n", HitArea::GetAllocatorStats().slabs);
+    std::printf("}\n");
+    return 0;
+}
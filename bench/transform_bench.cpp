@@ -0,0 +1,160 @@
+// Transform benchmark: TransformStore::Update, on hierarchies shaped like the game's tanks,
+// against the old way of computing the world matrices, with three full 4x4 products per
+// transform (parent * Translate * Rotate * Scale). The old way is only kept here, as the
+// baseline; it computes the world position, rotation and scale like Calculate does too, so
+// the two only differ in the matrices. The transforms have no hitareas, whose refit is the
+// same work either way. Prints the time per transform of both and how far apart the
+// matrices end up, as JSON.
+//
+// usage: transform_bench [--tanks N] [--frames F] [--warmup W] [--seed X]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "main/wisteria_engine/gameobject3d.h"
+#include "main/wisteria_engine/transform3d.h"
+
+using namespace engine;
+
+struct Options {
+    int tanks = 1000;
+    int frames = 200;
+    int warmup = 20;
+    unsigned seed = 1;
+};
+
+static Options ParseOptions(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            exit(1);
+        }
+        const char *value = argv[++i];
+        if (arg == "--tanks") options.tanks = std::atoi(value);
+        else if (arg == "--frames") options.frames = std::atoi(value);
+        else if (arg == "--warmup") options.warmup = std::atoi(value);
+        else if (arg == "--seed") options.seed = (unsigned)std::atoi(value);
+        else {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            exit(1);
+        }
+    }
+    return options;
+}
+
+// like the game's tanks: a body, two tracks and a turret, which holds the cannon. The
+// store is the bench's own, filled parents first like GameObject::transforms; every
+// transform still gets a gameobject as its owner, which Calculate tells about the change
+static void MakeTanks(const Options &options, TransformStore &store)
+{
+    std::mt19937 random(options.seed);
+    std::uniform_real_distribution<float> uniform(-1, 1);
+    auto vector = [&]() { return glm::vec3(uniform(random), uniform(random), uniform(random)); };
+    auto rotation = [&]() { return glm::angleAxis(3.14f * uniform(random), glm::normalize(vector() + glm::vec3(0, 2, 0))); };
+
+    for (int i = 0; i < options.tanks; ++i) {
+        int body = store.Add(new GameObject(), -1, 100.0f * vector(), glm::vec3(1.5f), rotation());
+        store.Add(new GameObject(), body, glm::vec3(-0.8f, 0, 0), glm::vec3(0.2f, 0.3f, 1.2f), QUAT1);
+        store.Add(new GameObject(), body, glm::vec3(0.8f, 0, 0), glm::vec3(0.2f, 0.3f, 1.2f), QUAT1);
+        int turret = store.Add(new GameObject(), body, glm::vec3(0, 0.5f, 0), glm::vec3(0.6f, 0.4f, 0.6f), rotation());
+        store.Add(new GameObject(), turret, glm::vec3(0, 0, 1), glm::vec3(0.1f, 0.1f, 2), QUAT1);
+    }
+    store.Update();
+}
+
+// the world transforms computed the old way, next to the store's
+struct Baseline
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> pseudoScales;
+    std::vector<glm::mat4> matrices;
+};
+
+// TransformStore::Calculate for every transform, as it was before TRS and MultiplyAffine.
+// Leaves the store as it is; the bench gameobjects don't use fixedRotation
+static void SweepMatrixProducts(const TransformStore &store, Baseline &b)
+{
+    size_t count = store.Size();
+    b.positions.resize(count);
+    b.rotations.resize(count);
+    b.pseudoScales.resize(count);
+    b.matrices.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        int parent = store.parents[i];
+        glm::vec3 parentPosition = parent == -1 ? glm::vec3(0) : b.positions[parent];
+        glm::quat parentRotation = parent == -1 ? QUAT1 : b.rotations[parent];
+        glm::vec3 parentScale = parent == -1 ? glm::vec3(1) : b.pseudoScales[parent];
+
+        b.positions[i] = parentPosition + parentRotation * (parentScale * store.localPositions[i]);
+        b.rotations[i] = parentRotation * store.localRotations[i];
+        b.pseudoScales[i] = store.localScales[i] * parentScale;
+        b.matrices[i] = (parent == -1 ? glm::mat4(1) : b.matrices[parent]) *
+            transform::Translate(store.localPositions[i]) *
+            transform::Rotate(store.localRotations[i]) *
+            transform::Scale(store.localScales[i]);
+        store.owners[i]->OnTransformChange();
+    }
+}
+
+// turns every tank a little, which makes all of their transforms dirty
+static void Turn(TransformStore &store)
+{
+    static const glm::quat turn = glm::angleAxis(0.01f, glm::vec3(0, 1, 0));
+    for (size_t i = 0; i < store.Size(); ++i) {
+        if (store.parents[i] == -1)
+            store.localRotations[i] = turn * store.localRotations[i];
+        store.dirty[i] = true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options = ParseOptions(argc, argv);
+    TransformStore store;
+    MakeTanks(options, store);
+    Baseline baseline;
+
+    // both run on the same dirty transforms every frame, the baseline first, since it
+    // leaves them dirty for Update
+    std::chrono::nanoseconds productsTime(0), updateTime(0);
+    for (int frame = 0; frame < options.warmup + options.frames; ++frame) {
+        Turn(store);
+        auto start = std::chrono::steady_clock::now();
+        SweepMatrixProducts(store, baseline);
+        auto middle = std::chrono::steady_clock::now();
+        store.Update();
+        auto end = std::chrono::steady_clock::now();
+        if (frame >= options.warmup) {
+            productsTime += middle - start;
+            updateTime += end - middle;
+        }
+    }
+
+    float maxDifference = 0;
+    for (size_t i = 0; i < store.Size(); ++i)
+        for (int column = 0; column < 4; ++column)
+            for (int row = 0; row < 4; ++row)
+                maxDifference = glm::max(maxDifference, glm::abs(store.matrices[i][column][row] -
+                                                                 baseline.matrices[i][column][row]));
+
+    double transforms = (double)store.Size() * (options.frames > 0 ? options.frames : 1);
+    double productsNs = productsTime.count() / transforms;
+    double updateNs = updateTime.count() / transforms;
+    std::printf("{\n");
+    std::printf("  \"tanks\": %d,\n", options.tanks);
+    std::printf("  \"transforms\": %zu,\n", store.Size());
+    std::printf("  \"frames\": %d,\n", options.frames);
+    std::printf("  \"ns_per_transform_products\": %.2f,\n", productsNs);
+    std::printf("  \"ns_per_transform_update\": %.2f,\n", updateNs);
+    std::printf("  \"speedup\": %.2f,\n", updateNs > 0 ? productsNs / updateNs : 0.0);
+    std::printf("  \"max_difference\": %g\n", maxDifference);
+    std::printf("}\n");
+    return 0;
+}
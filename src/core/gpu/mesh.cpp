@@ -23,6 +23,9 @@ Mesh::Mesh(std::string meshID)
     useMaterial = true;
     glDrawMode = GL_TRIANGLES;
     buffers = new GPUBuffers();
+
+    boundsMin = boundsMax = boundingSphereCenter = glm::vec3(0);
+    boundingSphereRadius = -1;
 }
 
 
@@ -40,6 +43,12 @@ const GPUBuffers * Mesh::GetBuffers() const
 }
 
 
+const std::vector<MeshEntry>& Mesh::GetMeshEntries() const
+{
+    return meshEntries;
+}
+
+
 const char * Mesh::GetMeshID() const
 {
     return meshID.c_str();
@@ -55,6 +64,33 @@ void Mesh::ClearData()
     texCoords.clear();
     indices.clear();
     normals.clear();
+    boundingSphereRadius = -1;
+}
+
+
+void Mesh::ComputeBounds()
+{
+    size_t count = positions.empty() ? vertices.size() : positions.size();
+    auto position = [&](size_t i) { return positions.empty() ? vertices[i].position : positions[i]; };
+    if (count == 0) {
+        boundingSphereRadius = -1;
+        return;
+    }
+
+    boundsMin = boundsMax = position(0);
+    for (size_t i = 1; i < count; i++) {
+        boundsMin = glm::min(boundsMin, position(i));
+        boundsMax = glm::max(boundsMax, position(i));
+    }
+
+    // Around the middle of the box, which is tighter than half its diagonal
+    boundingSphereCenter = (boundsMin + boundsMax) * 0.5f;
+    float radius2 = 0;
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 d = position(i) - boundingSphereCenter;
+        radius2 = glm::max(radius2, glm::dot(d, d));
+    }
+    boundingSphereRadius = glm::sqrt(radius2);
 }
 
 
@@ -92,6 +128,7 @@ void Mesh::InitFromData()
     M.nrIndices = (unsigned int)indices.size();
     meshEntries.push_back(M);
 
+    ComputeBounds();
     buffers->ReleaseMemory();
 }
 
@@ -107,6 +144,7 @@ bool Mesh::InitFromBuffer(unsigned int VAO,
     MeshEntry M;
     M.nrIndices = nrIndices;
     meshEntries.push_back(M);
+    boundingSphereRadius = -1;
 
     buffers->ReleaseMemory();
     buffers->m_VAO = VAO;
@@ -189,6 +227,7 @@ bool Mesh::InitFromScene(const aiScene* pScene)
         const aiMesh* paiMesh = pScene->mMeshes[i];
         InitMesh(paiMesh);
     }
+    ComputeBounds();
 
     if (useMaterial && !InitMaterials(pScene))
         return false;
@@ -87,6 +87,8 @@ class Mesh
     void Render() const;
 
     const GPUBuffers* GetBuffers() const;
+    // for drawing the mesh with the VAO already bound, see Render
+    const std::vector<MeshEntry>& GetMeshEntries() const;
     const char* GetMeshID() const;
 
  protected:
@@ -106,7 +108,17 @@ class Mesh
     std::vector<VertexFormat> vertices;
     std::vector<unsigned int> indices;
 
+    // Object space bounds of the vertices, computed when the mesh is initialized from
+    // data on the CPU. The radius is negative if there are none (InitFromBuffer)
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    glm::vec3 boundingSphereCenter;
+    float boundingSphereRadius;
+
  protected:
+    // From positions, or from vertices if there are no positions
+    void ComputeBounds();
+
     std::string fileLocation;
 
     bool useMaterial;
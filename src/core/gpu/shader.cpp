@@ -62,7 +62,35 @@ void Shader::BindTexturesUnits()
 
 GLint Shader::GetUniformLocation(const char *uniformName) const
 {
-    return glGetUniformLocation(program, uniformName);
+    return GetUniformLocation(std::string(uniformName));
+}
+
+
+GLint Shader::GetUniformLocation(const std::string &uniformName) const
+{
+    auto location = uniformLocations.find(uniformName);
+    return location == uniformLocations.end() ? INVALID_LOC : location->second;
+}
+
+
+const Shader::Attribute * Shader::GetAttribute(const std::string &attributeName) const
+{
+    auto attribute = attributes.find(attributeName);
+    return attribute == attributes.end() ? nullptr : &attribute->second;
+}
+
+
+const std::unordered_map<std::string, Shader::Attribute> & Shader::GetAttributes() const
+{
+    return attributes;
+}
+
+
+void Shader::BindUniformBlock(const char *blockName, GLuint bindingPoint)
+{
+    GLuint blockIndex = glGetUniformBlockIndex(program, blockName);
+    if (blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, blockIndex, bindingPoint);
 }
 
 
@@ -72,6 +100,67 @@ void Shader::OnLoad(std::function<void()> onLoad)
 }
 
 
+void Shader::ReflectUniforms()
+{
+    uniformLocations.clear();
+
+    GLint uniformCount = 0, maxNameLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<char> name(maxNameLength + 1);
+
+    for (GLint i = 0; i < uniformCount; i++) {
+        GLint size = 0;
+        GLenum type = 0;
+        GLsizei length = 0;
+        glGetActiveUniform(program, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+        std::string uniformName(&name[0], length);
+
+        // Members of uniform blocks have no location
+        GLint location = glGetUniformLocation(program, uniformName.c_str());
+        if (location == INVALID_LOC)
+            continue;
+        uniformLocations[uniformName] = location;
+
+        // Arrays are listed once, as "name[0]"; every element can be looked up
+        size_t bracket = uniformName.rfind("[0]");
+        if (bracket == std::string::npos || bracket + 3 != uniformName.size())
+            continue;
+        std::string arrayName = uniformName.substr(0, bracket);
+        uniformLocations[arrayName] = location;
+        for (GLint element = 1; element < size; element++) {
+            std::string elementName = arrayName + "[" + std::to_string(element) + "]";
+            uniformLocations[elementName] = glGetUniformLocation(program, elementName.c_str());
+        }
+    }
+}
+
+
+void Shader::ReflectAttributes()
+{
+    attributes.clear();
+
+    GLint attributeCount = 0, maxNameLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxNameLength);
+    std::vector<char> name(maxNameLength + 1);
+
+    for (GLint i = 0; i < attributeCount; i++) {
+        GLint size = 0;
+        GLenum type = 0;
+        GLsizei length = 0;
+        glGetActiveAttrib(program, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+        std::string attributeName(&name[0], length);
+
+        // Built-in inputs, like gl_VertexID, have no location
+        GLint location = glGetAttribLocation(program, attributeName.c_str());
+        if (location == INVALID_LOC)
+            continue;
+        attributes[attributeName] = {location, type};
+    }
+}
+
+
 void Shader::GetUniforms()
 {
     // MVP
@@ -160,6 +249,8 @@ unsigned int Shader::CreateAndLink()
         if (program)
         {
             glUseProgram(program);
+            ReflectUniforms();
+            ReflectAttributes();
             GetUniforms();
             for (auto Observer : loadObservers) {
                 Observer();
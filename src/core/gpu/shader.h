@@ -4,6 +4,7 @@
 #include <vector>
 #include <list>
 #include <functional>
+#include <unordered_map>
 
 #include "utils/gl_utils.h"
 
@@ -30,11 +31,28 @@ class Shader
     unsigned int CreateAndLink();
 
     void BindTexturesUnits();
+    // Looked up in the table of active uniforms made when the program was linked,
+    // so it doesn't call into GL. INVALID_LOC for uniforms the program doesn't use
     GLint GetUniformLocation(const char * uniformName) const;
+    GLint GetUniformLocation(const std::string &uniformName) const;
+    // The active vertex inputs, also reflected when the program was linked. Matrices
+    // take one location per column, starting at location
+    struct Attribute
+    {
+        GLint location;
+        GLenum type;
+    };
+    // nullptr for inputs the program doesn't use
+    const Attribute *GetAttribute(const std::string &attributeName) const;
+    const std::unordered_map<std::string, Attribute> &GetAttributes() const;
+    // Points the named uniform block at a uniform buffer binding point
+    void BindUniformBlock(const char *blockName, GLuint bindingPoint);
 
     void OnLoad(std::function<void()> onLoad);
 
  private:
+    void ReflectUniforms();
+    void ReflectAttributes();
     void GetUniforms();
     static unsigned int CreateShader(const std::string &shaderFile, GLenum shaderType);
     static unsigned int CompileShader(const std::string shaderCode, GLenum shaderType);
@@ -80,4 +98,6 @@ class Shader
     std::vector<ShaderFile> shaderFiles;
     std::vector<ShaderFile> shaderCodes;
     std::list<std::function<void()>> loadObservers;
+    std::unordered_map<std::string, GLint> uniformLocations;
+    std::unordered_map<std::string, Attribute> attributes;
 };
@@ -9,6 +9,10 @@
 using namespace engine;
 using namespace game;
 
+const int game::TAG_TANK = Tags::Id("Tank");
+const int game::TAG_BUILDING = Tags::Id("Building");
+const int game::TAG_CANNONBALL = Tags::Id("Cannonball");
+
 #define MAP_SIZE 100
 #define MINIMAP_SIZE 40
 #define MAP_SCALE 250
@@ -17,6 +21,7 @@ using namespace game;
 #define CAMERA_MOUSE_SENSITIVITY 0.004f
 #define TURRET_MOUSE_SENSITIVITY 0.004f
 #define CANNON_MOUSE_SENSITIVITY 0.003f
+#define BROADPHASE_CELL_SIZE 8.0f
 
 // initialize engine-independent members
 Game::Game()
@@ -68,6 +73,8 @@ void Game::Initialize()
     collisionMasks[LAYER_TANKS] = (1 << LAYER_BUILDINGS) | (1 << LAYER_TANKS) | (1 << LAYER_CANNONBALLS);
     collisionMasks[LAYER_BUILDINGS] = (1 << LAYER_TANKS) | (1 << LAYER_CANNONBALLS);
     collisionMasks[LAYER_CANNONBALLS] = (1 << LAYER_BUILDINGS) | (1 << LAYER_TANKS);
+    // the lock walls are 2 units thick, just outside of the map
+    collisionWorld.grid.SetBounds(glm::vec2(-MAP_SIZE - 2), glm::vec2(MAP_SIZE + 2), BROADPHASE_CELL_SIZE);
     SetupScene();
 }
 
@@ -81,6 +88,7 @@ void Game::SetupScene()
     GameObject *skybox = new GameObject(Assets::meshes["skycube"], glm::vec3(0), glm::vec3(MAP_SCALE));
     skybox->material = Assets::materials["textured"];
     skybox->material.texture = Assets::textures["skybox"];
+    skybox->renderPass = RENDER_PASS_BACKGROUND;
     AddToScene(skybox);
 
     playerTank = new Tank(glm::vec3(0));
@@ -108,7 +116,8 @@ void Game::AddLocks()
     eastWall->SetBoxHitArea(2, 1, 2 * MAP_SIZE);
     westWall->SetBoxHitArea(2, 1, 2 * MAP_SIZE);
     for (auto &wall : {northWall, southWall, eastWall, westWall}) {
-        wall->tag = "Building";
+        wall->AddTag(TAG_BUILDING);
+        wall->bodyType = BODY_STATIC;
         AddToScene(wall);
         AddToLayer(wall, LAYER_BUILDINGS);
     }
@@ -195,10 +204,11 @@ void Game::AddBuildings()
         building->material = Assets::materials["transformTexture"];
         building->material.texture = Assets::textures[textureName];
         building->material.SetMat3("UV_TRANSFORM", textureScale);
-        building->tag = "Building";
+        building->AddTag(TAG_BUILDING);
         buildings.insert(building);
 
         building->SetBoxHitArea(1, 1, 1, glm::vec3(0, 0.5f, 0));
+        building->bodyType = BODY_STATIC;
         AddToScene(building);
         AddToLayer(building, LAYER_BUILDINGS);
     }
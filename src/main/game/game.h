@@ -1,4 +1,5 @@
 #pragma once
+#include <unordered_set>
 #include "components/simple_scene.h"
 
 #include "../wisteria_engine/controlledscene3d.h"
@@ -8,6 +8,11 @@
 
 namespace game
 {
+    // tags, interned when the game starts; the handlers compare these, not the names
+    extern const int TAG_TANK;
+    extern const int TAG_BUILDING;
+    extern const int TAG_CANNONBALL;
+
     inline float randomFloat(float min, float max)
     {
         return min + static_cast<float>(rand()) / static_cast<float>(RAND_MAX / (max - min));
@@ -4,11 +4,10 @@
 in vec3 frag_position;
 in vec3 frag_normal;
 in vec3 frag_color;
+flat in int frag_hp;
 
 layout(location = 0) out vec4 out_color;
 
-uniform int HP;
-
 
 void main()
 {
@@ -23,12 +22,12 @@ void main()
     vec3 brown = vec3(0.3, 0.17, 0.0);
     vec3 dark_brown = vec3(0.17, 0.11, 0.0);
     vec3 color = frag_color;
-    if (HP <= 2) {
+    if (frag_hp <= 2) {
         float percent = (sin(2 * PI * tangent_component) + cos(3 * PI * bitangent_component)) / 2.0;
         percent = smoothstep(-1.0, 1.0, percent);
         color = mix(brown, frag_color, percent);
     }
-    if (HP == 1) {
+    if (frag_hp == 1) {
         float perent = (sin(PI * bitangent_component) + cos(PI * tangent_component)) / 2.0;
         color = mix(dark_brown, color, perent);
     }
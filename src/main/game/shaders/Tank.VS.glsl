@@ -4,17 +4,23 @@
 layout(location = 0) in vec3 v_position;
 layout(location = 1) in vec3 v_normal;
 layout(location = 3) in vec3 v_color;
+// per instance, so every tank part with the same mesh is drawn at once
+layout(location = 4) in mat4 WIST_MODEL_MATRIX;
+layout(location = 8) in int HP;
+layout(location = 9) in float SUB_HUE;
+layout(location = 10) in float ADD_HUE;
 
-uniform mat4 WIST_MODEL_MATRIX;
-uniform mat4 WIST_VIEW_MATRIX;
-uniform mat4 WIST_PROJECTION_MATRIX;
-uniform int HP;
-uniform float SUB_HUE;
-uniform float ADD_HUE;
+layout(std140) uniform WIST_CAMERA
+{
+    mat4 WIST_VIEW_MATRIX;
+    mat4 WIST_PROJECTION_MATRIX;
+    vec4 WIST_EYE_POSITION;
+};
 
 out vec3 frag_position;
 out vec3 frag_normal;
 out vec3 frag_color;
+flat out int frag_hp;
 
 // conversion function from https://stackoverflow.com/questions/68901847/opengl-esconvert-rgb-to-hsv-not-hsl
 vec3 HSVtoRGB(in vec3 HSV)
@@ -58,6 +64,7 @@ void main()
     vec3 v_affected_position = apply_deformation(v_position, 3 - HP);
     frag_position = v_affected_position;
     frag_normal = v_normal;
+    frag_hp = HP;
     frag_color = HSVtoRGB(RGBtoHSV(v_color) + vec3(ADD_HUE - SUB_HUE, 0, 0));
     mat4 MVP = WIST_PROJECTION_MATRIX * WIST_VIEW_MATRIX * WIST_MODEL_MATRIX;
     gl_Position = MVP * vec4(v_affected_position, 1.0);
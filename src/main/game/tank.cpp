@@ -36,7 +36,7 @@ Tank::Tank(glm::vec3 pos, glm::vec3 scale, glm::quat rot): GameObject(pos, scale
 {
     if (!initialized) Init();
 
-    tag = "Tank";
+    AddTag(TAG_TANK);
     mesh = Assets::meshes["tank_base"];
     left_track = this->CreateChild(Assets::meshes["tank_track"], glm::vec3(0.42f, 0, 0));
     right_track = this->CreateChild(Assets::meshes["tank_track"], glm::vec3(-0.42f, 0, 0));
@@ -74,7 +74,7 @@ void Tank::OnCollision(const SphereBoxCollisionEvent &collision)
     if (collision.distance == 0)
         return;  // ignore touch collisions
 
-    if (collision.gameObject->tag == "Building") {
+    if (collision.gameObject->HasTag(TAG_BUILDING)) {
         OnCollisionWall(collision);
     }
 }
@@ -84,15 +84,15 @@ void Tank::OnCollision(const SphereSphereCollisionEvent &collision)
     if (collision.distance == 0)
         return;  // ignore touch collisions
 
-    if (collision.gameObject->tag == "Cannonball") {
+    if (collision.gameObject->HasTag(TAG_CANNONBALL)) {
         Cannonball *cannonball = static_cast<Cannonball *>(collision.gameObject);
-        if (cannonball->sourceTank != this) OnHit();
-    } else if (collision.gameObject->tag == "Tank") {
+        if (cannonball->sourceTank != handle) OnHit();
+    } else if (collision.gameObject->HasTag(TAG_TANK)) {
         OnCollisionTank(collision);
     }
 }
 
-void Tank::ReactOverlap(glm::vec3 dirToContact, float distance)
+void Tank::ReactOverlap(GameObject *other, glm::vec3 dirToContact, float distance)
 {
     // didn't know which way of calculating the 'push back' is better, so I used both
     // they have their pros and cons
@@ -110,7 +110,7 @@ void Tank::ReactOverlap(glm::vec3 dirToContact, float distance)
     } else {
         float overlap = collisionRadius - distance;
         glm::vec3 overlapDirection = dirToContact;
-        float cosAngle = glm::dot(overlapDirection, forward);
+        float cosAngle = glm::dot(overlapDirection, GetForward());
         float absCosAngle = glm::abs(cosAngle);
         // completely ignore collisions realllly close to parallel
         if (absCosAngle < 0.03f) return;
@@ -123,23 +123,28 @@ void Tank::ReactOverlap(glm::vec3 dirToContact, float distance)
         } else {
             drawback = overlap / cosAngle;
         }
-        drawbackVector = -forward * drawback;
+        drawbackVector = -GetForward() * drawback;
     }
 
-    Translate(drawbackVector);
+    // resolved along with the other contacts of the step, see ContactSolver
+    scene->PushOut(this, other, drawbackVector);
+}
+
+void Tank::OnPositionCorrection(glm::vec3 correction)
+{
     if (followCamera) 
-        followCamera->Translate(drawbackVector);
+        followCamera->Translate(correction);
 }
 
 void Tank::OnCollisionTank(const SphereSphereCollisionEvent &collision)
 {
-    ReactOverlap(collision.displacement / collision.distance, 
+    ReactOverlap(collision.gameObject, collision.displacement / collision.distance, 
                  collision.distance - collisionRadius);
 }
 
 void Tank::OnCollisionWall(const SphereBoxCollisionEvent &collision)
 {
-    ReactOverlap(collision.displacement / collision.distance, collision.distance);
+    ReactOverlap(collision.gameObject, collision.displacement / collision.distance, collision.distance);
 }
 
 void Tank::OnHit()
@@ -185,10 +190,10 @@ void Tank::Update(float deltaTime)
         cannonRot.x = glm::max(cannonRot.x, glm::radians(-30.0f));
         cannon->SetLocalRotation(glm::quat(cannonRot));
     } else if (currentAction & TANK_ACTION_LEFT) {
-        glm::quat rot = glm::angleAxis(glm::radians(angularSpeed * deltaTime), up);
+        glm::quat rot = glm::angleAxis(glm::radians(angularSpeed * deltaTime), GetUp());
         Rotate(rot);
     } else if (currentAction & TANK_ACTION_RIGHT) {
-        glm::quat rot = glm::angleAxis(glm::radians(-angularSpeed * deltaTime), up);
+        glm::quat rot = glm::angleAxis(glm::radians(-angularSpeed * deltaTime), GetUp());
         Rotate(rot);
     }
 
@@ -196,10 +201,10 @@ void Tank::Update(float deltaTime)
         Fire();
         currentAction &= ~TANK_ACTION_FIRE;  // one-time action
     } else if (currentAction & TANK_ACTION_TURRET_LEFT) {
-        glm::quat rot = glm::angleAxis(glm::radians(turretSpeed * deltaTime), up);
+        glm::quat rot = glm::angleAxis(glm::radians(turretSpeed * deltaTime), GetUp());
         turret->Rotate(rot);
     } else if (currentAction & TANK_ACTION_TURRET_RIGHT) {
-        glm::quat rot = glm::angleAxis(glm::radians(-turretSpeed * deltaTime), up);
+        glm::quat rot = glm::angleAxis(glm::radians(-turretSpeed * deltaTime), GetUp());
         turret->Rotate(rot);
     }
     nextActionIn -= deltaTime;
@@ -210,30 +215,31 @@ float Cannonball::gravity = -9.81f;
 Cannonball::Cannonball(const Tank *tank): GameObject(Assets::meshes["cannonball"], 
     tank->cannon->GetPosition() + tank->cannon->GetForward() * Tank::cannonLength)
 {
-    sourceTank = tank;
-    tag = "Cannonball";
+    sourceTank = tank->GetHandle();
+    AddTag(TAG_CANNONBALL);
     velocity = tank->cannon->GetForward() * initialSpeed;
     acceleration = glm::vec3(0, gravity, 0);
     SetSphereHitArea(1);
+    continuousCollision = true;  // fast enough to go through the thinner walls on slow frames
 }
 
 void Cannonball::OnCollision(const SphereBoxCollisionEvent &event)
 {
-    if (event.gameObject->tag != "Building")
+    if (!event.gameObject->HasTag(TAG_BUILDING))
         return;
     scene->Destroy(this);
 }
 
 void Cannonball::OnCollision(const SphereSphereCollisionEvent &event)
 {
-    if (event.gameObject->tag != "Tank" || event.gameObject == sourceTank)
+    if (!event.gameObject->HasTag(TAG_TANK) || event.gameObject->GetHandle() == sourceTank)
         return;
     scene->Destroy(this);
 }
 
 void Cannonball::OnTransformChange()
 {
-    if (position.y < 0) {
+    if (GetPosition().y < 0) {
         scene->Destroy(this);
     }
 }
@@ -46,6 +46,7 @@ namespace game
 
         void OnCollision(const SphereBoxCollisionEvent &event) override;
         void OnCollision(const SphereSphereCollisionEvent &event) override;
+        void OnPositionCorrection(glm::vec3 correction) override;
 
         void SetHueVariation(int hueIndex);
         void SetFollowCamera(Camera *camera) { followCamera = camera; }
@@ -58,7 +59,7 @@ namespace game
         static void Init();
         static bool initialized;
 
-        void ReactOverlap(glm::vec3 dirToContact, float distance);
+        void ReactOverlap(GameObject *other, glm::vec3 dirToContact, float distance);
         void OnCollisionTank(const SphereSphereCollisionEvent &collision);
         void OnCollisionWall(const SphereBoxCollisionEvent &collision);
         void OnHit();
@@ -81,7 +82,7 @@ namespace game
         void OnCollision(const SphereSphereCollisionEvent &event) override;
         void OnTransformChange() override;
 
-        const Tank *sourceTank;
+        Handle sourceTank;  // the tank may be destroyed before the cannonball
 
         static float initialSpeed;
         static float gravity;
@@ -0,0 +1,250 @@
+#include "aabbtree3d.h"
+
+using namespace engine;
+
+#define AABB_TREE_INITIAL_CAPACITY 64
+
+DynamicAABBTree::DynamicAABBTree()
+{
+    nodes.reserve(AABB_TREE_INITIAL_CAPACITY);
+}
+
+int DynamicAABBTree::AllocateNode()
+{
+    if (freeList == AABB_TREE_NULL_NODE) {
+        nodes.emplace_back();
+        return (int)nodes.size() - 1;
+    }
+
+    int nodeId = freeList;
+    freeList = nodes[nodeId].parent;
+    nodes[nodeId] = TreeNode();
+    return nodeId;
+}
+
+void DynamicAABBTree::FreeNode(int nodeId)
+{
+    nodes[nodeId].parent = freeList;
+    nodes[nodeId].height = -1;
+    nodes[nodeId].gameObject = nullptr;
+    freeList = nodeId;
+}
+
+int DynamicAABBTree::CreateProxy(const AABB &bounds, GameObject *gameObject, float margin)
+{
+    int proxyId = AllocateNode();
+    nodes[proxyId].aabb = bounds.Fattened(margin);
+    nodes[proxyId].gameObject = gameObject;
+    nodes[proxyId].height = 0;
+    InsertLeaf(proxyId);
+    return proxyId;
+}
+
+void DynamicAABBTree::DestroyProxy(int proxyId)
+{
+    RemoveLeaf(proxyId);
+    FreeNode(proxyId);
+}
+
+bool DynamicAABBTree::MoveProxy(int proxyId, const AABB &bounds, float margin)
+{
+    if (nodes[proxyId].aabb.Contains(bounds))
+        return false;
+
+    RemoveLeaf(proxyId);
+    nodes[proxyId].aabb = bounds.Fattened(margin);
+    InsertLeaf(proxyId);
+    return true;
+}
+
+void DynamicAABBTree::InsertLeaf(int leaf)
+{
+    if (root == AABB_TREE_NULL_NODE) {
+        root = leaf;
+        nodes[root].parent = AABB_TREE_NULL_NODE;
+        return;
+    }
+
+    // descend to the sibling that makes the tree cheapest, by the surface area heuristic:
+    // the cost of a node is its area, and every ancestor grows to enclose the new leaf
+    AABB leafAABB = nodes[leaf].aabb;
+    int index = root;
+    while (!nodes[index].IsLeaf()) {
+        int child1 = nodes[index].child1;
+        int child2 = nodes[index].child2;
+
+        float area = nodes[index].aabb.SurfaceArea();
+        float combinedArea = AABB::Union(nodes[index].aabb, leafAABB).SurfaceArea();
+        // cost of making a new parent for this node and the new leaf
+        float cost = 2.0f * combinedArea;
+        // minimum cost of pushing the leaf further down the tree
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float cost1 = AABB::Union(leafAABB, nodes[child1].aabb).SurfaceArea() + inheritanceCost;
+        if (!nodes[child1].IsLeaf())
+            cost1 -= nodes[child1].aabb.SurfaceArea();
+        float cost2 = AABB::Union(leafAABB, nodes[child2].aabb).SurfaceArea() + inheritanceCost;
+        if (!nodes[child2].IsLeaf())
+            cost2 -= nodes[child2].aabb.SurfaceArea();
+
+        if (cost < cost1 && cost < cost2)
+            break;
+        index = (cost1 < cost2) ? child1 : child2;
+    }
+
+    int sibling = index;
+    int oldParent = nodes[sibling].parent;
+    int newParent = AllocateNode();  // may grow the vector; only use indices from here on
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].aabb = AABB::Union(leafAABB, nodes[sibling].aabb);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == AABB_TREE_NULL_NODE) {
+        root = newParent;
+    } else if (nodes[oldParent].child1 == sibling) {
+        nodes[oldParent].child1 = newParent;
+    } else {
+        nodes[oldParent].child2 = newParent;
+    }
+
+    Refit(nodes[leaf].parent);
+}
+
+void DynamicAABBTree::RemoveLeaf(int leaf)
+{
+    if (leaf == root) {
+        root = AABB_TREE_NULL_NODE;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = (nodes[parent].child1 == leaf) ? nodes[parent].child2 : nodes[parent].child1;
+
+    // the sibling takes the place of the parent
+    nodes[sibling].parent = grandParent;
+    FreeNode(parent);
+    if (grandParent == AABB_TREE_NULL_NODE) {
+        root = sibling;
+        return;
+    }
+
+    if (nodes[grandParent].child1 == parent)
+        nodes[grandParent].child1 = sibling;
+    else
+        nodes[grandParent].child2 = sibling;
+    Refit(grandParent);
+}
+
+// walks up to the root, rebalancing and recomputing the bounds and heights
+void DynamicAABBTree::Refit(int nodeId)
+{
+    int index = nodeId;
+    while (index != AABB_TREE_NULL_NODE) {
+        index = Balance(index);
+
+        TreeNode &node = nodes[index];
+        const TreeNode &child1 = nodes[node.child1];
+        const TreeNode &child2 = nodes[node.child2];
+        node.height = 1 + glm::max(child1.height, child2.height);
+        node.aabb = AABB::Union(child1.aabb, child2.aabb);
+
+        index = node.parent;
+    }
+}
+
+// if the subtree rooted at A is unbalanced, rotates its taller child up.
+// Returns the new root of the subtree
+int DynamicAABBTree::Balance(int iA)
+{
+    TreeNode &A = nodes[iA];
+    if (A.IsLeaf() || A.height < 2)
+        return iA;
+
+    int iB = A.child1;
+    int iC = A.child2;
+    TreeNode &B = nodes[iB];
+    TreeNode &C = nodes[iC];
+    int balance = C.height - B.height;
+
+    if (balance > 1) {
+        // rotate C up
+        int iF = C.child1;
+        int iG = C.child2;
+        TreeNode &F = nodes[iF];
+        TreeNode &G = nodes[iG];
+
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+        if (C.parent == AABB_TREE_NULL_NODE)
+            root = iC;
+        else if (nodes[C.parent].child1 == iA)
+            nodes[C.parent].child1 = iC;
+        else
+            nodes[C.parent].child2 = iC;
+
+        // the taller grandchild stays under C, the shorter one goes to A
+        if (F.height > G.height) {
+            C.child2 = iF;
+            A.child2 = iG;
+            G.parent = iA;
+            A.aabb = AABB::Union(B.aabb, G.aabb);
+            C.aabb = AABB::Union(A.aabb, F.aabb);
+            A.height = 1 + glm::max(B.height, G.height);
+            C.height = 1 + glm::max(A.height, F.height);
+        } else {
+            C.child2 = iG;
+            A.child2 = iF;
+            F.parent = iA;
+            A.aabb = AABB::Union(B.aabb, F.aabb);
+            C.aabb = AABB::Union(A.aabb, G.aabb);
+            A.height = 1 + glm::max(B.height, F.height);
+            C.height = 1 + glm::max(A.height, G.height);
+        }
+        return iC;
+    }
+
+    if (balance < -1) {
+        // rotate B up
+        int iD = B.child1;
+        int iE = B.child2;
+        TreeNode &D = nodes[iD];
+        TreeNode &E = nodes[iE];
+
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+        if (B.parent == AABB_TREE_NULL_NODE)
+            root = iB;
+        else if (nodes[B.parent].child1 == iA)
+            nodes[B.parent].child1 = iB;
+        else
+            nodes[B.parent].child2 = iB;
+
+        if (D.height > E.height) {
+            B.child2 = iD;
+            A.child1 = iE;
+            E.parent = iA;
+            A.aabb = AABB::Union(C.aabb, E.aabb);
+            B.aabb = AABB::Union(A.aabb, D.aabb);
+            A.height = 1 + glm::max(C.height, E.height);
+            B.height = 1 + glm::max(A.height, D.height);
+        } else {
+            B.child2 = iE;
+            A.child1 = iD;
+            D.parent = iA;
+            A.aabb = AABB::Union(C.aabb, D.aabb);
+            B.aabb = AABB::Union(A.aabb, E.aabb);
+            A.height = 1 + glm::max(C.height, D.height);
+            B.height = 1 + glm::max(A.height, E.height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <vector>
+#include "broadphase3d.h"
+
+#define AABB_TREE_NULL_NODE (-1)
+#define AABB_TREE_STACK_SIZE 128
+
+namespace engine
+{
+    class GameObject;
+
+    // A dynamic bounding volume hierarchy, in the spirit of Box2D's b2DynamicTree.
+    // Leaves are proxies: a (possibly fattened) AABB and the gameobject it belongs to.
+    // Internal nodes bound their two children. The tree is kept balanced with AVL-like
+    // rotations and new leaves are placed using the surface area heuristic.
+    // Moving a proxy whose new bounds still fit in its fat AABB costs nothing, so
+    // gameobjects that move a bit every frame are only reinserted every few frames.
+    class DynamicAABBTree
+    {
+    public:
+        DynamicAABBTree();
+
+        // returns the id of the new proxy; the stored AABB is bounds fattened by margin
+        int CreateProxy(const AABB &bounds, GameObject *gameObject, float margin);
+        void DestroyProxy(int proxyId);
+        // returns true if the proxy had to be reinserted, i.e. the new bounds
+        // were no longer contained by its fat AABB
+        bool MoveProxy(int proxyId, const AABB &bounds, float margin);
+
+        const AABB &GetFatAABB(int proxyId) const { return nodes[proxyId].aabb; }
+        GameObject *GetGameObject(int proxyId) const { return nodes[proxyId].gameObject; }
+        int GetHeight() const { return root == AABB_TREE_NULL_NODE ? 0 : nodes[root].height; }
+
+        // calls callback(proxyId) for every proxy whose fat AABB overlaps the given bounds;
+        // the callback returns false to stop the query early
+        template <typename Callback>
+        void Query(const AABB &bounds, Callback callback) const
+        {
+            int stack[AABB_TREE_STACK_SIZE];
+            int count = 0;
+            if (root != AABB_TREE_NULL_NODE)
+                stack[count++] = root;
+
+            while (count > 0) {
+                const TreeNode &node = nodes[stack[--count]];
+                if (!node.aabb.Overlaps(bounds))
+                    continue;
+                if (node.IsLeaf()) {
+                    if (!callback((int)(&node - nodes.data())))
+                        return;
+                } else {
+                    stack[count++] = node.child1;
+                    stack[count++] = node.child2;
+                }
+            }
+        }
+
+        // casts the segment from start to end, with the AABBs grown by radius for sphere
+        // casts, and calls callback(proxyId, maxFraction) for every proxy it crosses.
+        // The callback returns the fraction of the segment to clip the cast to: 0 stops it,
+        // the fraction of a hit keeps only what is in front of it, maxFraction goes on
+        template <typename Callback>
+        void RayCast(glm::vec3 start, glm::vec3 end, float radius, Callback callback) const
+        {
+            // a zero component would make (bound - start) * inverseDelta a NaN for
+            // bounds that touch the ray; a huge inverse gives the same answer otherwise
+            glm::vec3 delta = end - start;
+            glm::vec3 inverseDelta;
+            for (int i = 0; i < 3; ++i)
+                inverseDelta[i] = 1.0f / (delta[i] != 0 ? delta[i] : 1e-30f);
+            float maxFraction = 1;
+
+            int stack[AABB_TREE_STACK_SIZE];
+            int count = 0;
+            if (root != AABB_TREE_NULL_NODE)
+                stack[count++] = root;
+
+            while (count > 0) {
+                const TreeNode &node = nodes[stack[--count]];
+                if (!node.aabb.Fattened(radius).Raycast(start, inverseDelta, maxFraction))
+                    continue;
+                if (node.IsLeaf()) {
+                    float fraction = callback((int)(&node - nodes.data()), maxFraction);
+                    if (fraction <= 0)
+                        return;
+                    maxFraction = glm::min(maxFraction, fraction);
+                } else {
+                    stack[count++] = node.child1;
+                    stack[count++] = node.child2;
+                }
+            }
+        }
+
+    private:
+        struct TreeNode {
+            bool IsLeaf() const { return child1 == AABB_TREE_NULL_NODE; }
+
+            AABB aabb;
+            GameObject *gameObject = nullptr;
+            // free nodes are chained through the parent field
+            int parent = AABB_TREE_NULL_NODE;
+            int child1 = AABB_TREE_NULL_NODE;
+            int child2 = AABB_TREE_NULL_NODE;
+            int height = -1;  // leaves have height 0, free nodes -1
+        };
+
+        int AllocateNode();
+        void FreeNode(int nodeId);
+        void InsertLeaf(int leaf);
+        void RemoveLeaf(int leaf);
+        int Balance(int nodeId);
+        void Refit(int nodeId);
+
+        std::vector<TreeNode> nodes;
+        int root = AABB_TREE_NULL_NODE;
+        int freeList = AABB_TREE_NULL_NODE;
+    };
+}
@@ -12,6 +12,11 @@
 #pragma warning(disable: 4005)  // disable macro redefinition warning
 #define PATH_JOIN(...) (text_utils::Join(std::vector<std::string>{__VA_ARGS__}, std::string(1, PATH_SEPARATOR)))
 
+// the uniform block with the matrices and the position of the camera being drawn for,
+// which shaders declare as layout(std140) uniform WIST_CAMERA; see ControlledScene3D
+#define WIST_CAMERA_BLOCK "WIST_CAMERA"
+#define WIST_CAMERA_BINDING 0
+
 namespace engine
 {
     class Assets
@@ -35,6 +40,8 @@ namespace engine
             Shader *shader = new Shader(name);
             shader->AddShader(paths[vertexShader], GL_VERTEX_SHADER);
             shader->AddShader(paths[fragmentShader], GL_FRAGMENT_SHADER);
+            // on every link, reloads included
+            shader->OnLoad([shader]() { shader->BindUniformBlock(WIST_CAMERA_BLOCK, WIST_CAMERA_BINDING); });
             shader->CreateAndLink();
             shaders[name] = shader;
         }
@@ -46,7 +53,9 @@ namespace engine
                 std::cerr << "Shader " << shaderName << " not found";
                 exit(1);
             }
-            materials[name] = Material(shader);
+            MaterialTemplate *materialTemplate = new MaterialTemplate(shader);
+            materialTemplates[name] = materialTemplate;
+            materials[name] = Material(materialTemplate);
         }
 
         static void LoadTexture(const std::string &name, const std::string &fileLocation, 
@@ -61,6 +70,8 @@ namespace engine
         static std::unordered_map<std::string, Mesh *> meshes;
         static std::unordered_map<std::string, std::string> paths;
         static std::unordered_map<std::string, Shader *> shaders;
+        static std::unordered_map<std::string, MaterialTemplate *> materialTemplates;
+        // copy these into gameobjects, then set what differs on the copy
         static std::unordered_map<std::string, Material> materials;
         static std::unordered_map<std::string, Texture2D *> textures;
     };
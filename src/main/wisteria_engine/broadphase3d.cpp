@@ -0,0 +1,88 @@
+#include "broadphase3d.h"
+
+using namespace engine;
+
+#define DEFAULT_GRID_HALF_SIZE 128.0f
+#define DEFAULT_GRID_CELL_SIZE 8.0f
+
+UniformGrid::UniformGrid()
+{
+    SetBounds(glm::vec2(-DEFAULT_GRID_HALF_SIZE), glm::vec2(DEFAULT_GRID_HALF_SIZE),
+              DEFAULT_GRID_CELL_SIZE);
+}
+
+void UniformGrid::SetBounds(glm::vec2 min, glm::vec2 max, float cellSize)
+{
+    this->min = min;
+    this->max = max;
+    this->cellSize = cellSize;
+    cellsX = glm::max(1, (int)glm::ceil((max.x - min.x) / cellSize));
+    cellsZ = glm::max(1, (int)glm::ceil((max.y - min.y) / cellSize));
+}
+
+int UniformGrid::CellX(float x) const
+{
+    return glm::clamp((int)glm::floor((x - min.x) / cellSize), 0, cellsX - 1);
+}
+
+int UniformGrid::CellZ(float z) const
+{
+    return glm::clamp((int)glm::floor((z - min.y) / cellSize), 0, cellsZ - 1);
+}
+
+void UniformGrid::Build(const std::vector<BroadphaseProxy> &proxies)
+{
+    // counting sort of the proxies into cells: first count, then prefix sum, then fill
+    cellStart.assign(cellsX * cellsZ + 1, 0);
+    for (auto &proxy : proxies) {
+        int x0 = CellX(proxy.bounds.min.x), x1 = CellX(proxy.bounds.max.x);
+        int z0 = CellZ(proxy.bounds.min.z), z1 = CellZ(proxy.bounds.max.z);
+        for (int z = z0; z <= z1; ++z)
+            for (int x = x0; x <= x1; ++x)
+                cellStart[z * cellsX + x + 1]++;
+    }
+    for (size_t i = 1; i < cellStart.size(); ++i)
+        cellStart[i] += cellStart[i - 1];
+
+    cellEntries.resize(cellStart.back());
+    for (int i = 0; i < (int)proxies.size(); ++i) {
+        const AABB &bounds = proxies[i].bounds;
+        int x0 = CellX(bounds.min.x), x1 = CellX(bounds.max.x);
+        int z0 = CellZ(bounds.min.z), z1 = CellZ(bounds.max.z);
+        for (int z = z0; z <= z1; ++z)
+            for (int x = x0; x <= x1; ++x)
+                cellEntries[cellStart[z * cellsX + x]++] = i;
+    }
+    // the fill advanced every start to the start of the next cell; shift them back
+    for (size_t i = cellStart.size() - 1; i > 0; --i)
+        cellStart[i] = cellStart[i - 1];
+    cellStart[0] = 0;
+}
+
+void UniformGrid::QueryPairs(const std::vector<BroadphaseProxy> &proxies,
+                             std::vector<std::pair<int, int>> &pairs) const
+{
+    for (int cell = 0; cell < cellsX * cellsZ; ++cell) {
+        int cellX = cell % cellsX, cellZ = cell / cellsX;
+        for (int i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+            const BroadphaseProxy &a = proxies[cellEntries[i]];
+            for (int j = i + 1; j < cellStart[cell + 1]; ++j) {
+                const BroadphaseProxy &b = proxies[cellEntries[j]];
+                if (!a.awake && !b.awake)
+                    continue;
+                if ((a.collidesWith & b.layers) == 0 && (b.collidesWith & a.layers) == 0)
+                    continue;
+                if (!a.bounds.Overlaps(b.bounds))
+                    continue;
+                // two proxies spanning several cells meet in all of them. Only the cell
+                // holding the min corner of their overlap reports the pair; both proxies
+                // are guaranteed to be in that cell
+                float overlapX = glm::max(a.bounds.min.x, b.bounds.min.x);
+                float overlapZ = glm::max(a.bounds.min.z, b.bounds.min.z);
+                if (CellX(overlapX) != cellX || CellZ(overlapZ) != cellZ)
+                    continue;
+                pairs.emplace_back(cellEntries[i], cellEntries[j]);
+            }
+        }
+    }
+}
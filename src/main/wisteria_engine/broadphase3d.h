@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "utils/glm_utils.h"
+
+namespace engine
+{
+    class GameObject;
+
+    // axis aligned bounding box, always in world space
+    struct AABB {
+        AABB() = default;
+        AABB(glm::vec3 min, glm::vec3 max) : min(min), max(max) {}
+
+        glm::vec3 min = glm::vec3(0);
+        glm::vec3 max = glm::vec3(0);
+
+        bool Overlaps(const AABB &other) const
+        {
+            return min.x <= other.max.x && max.x >= other.min.x &&
+                   min.y <= other.max.y && max.y >= other.min.y &&
+                   min.z <= other.max.z && max.z >= other.min.z;
+        }
+
+        bool Contains(const AABB &other) const
+        {
+            return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+                   max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+        }
+
+        AABB Fattened(float margin) const
+        {
+            return AABB(min - glm::vec3(margin), max + glm::vec3(margin));
+        }
+
+        float SurfaceArea() const
+        {
+            glm::vec3 size = max - min;
+            return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+        }
+
+        // whether the segment start + t * delta, for t in [0, maxFraction], crosses the box.
+        // Takes 1 / delta, which must be finite (see DynamicAABBTree::RayCast)
+        bool Raycast(glm::vec3 start, glm::vec3 inverseDelta, float maxFraction) const
+        {
+            glm::vec3 t1 = (min - start) * inverseDelta;
+            glm::vec3 t2 = (max - start) * inverseDelta;
+            glm::vec3 tNear = glm::min(t1, t2);
+            glm::vec3 tFar = glm::max(t1, t2);
+            float enter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+            float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxFraction));
+            return enter <= exit;
+        }
+
+        static AABB Union(const AABB &a, const AABB &b)
+        {
+            return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+        }
+    };
+
+    // what the broadphase knows about a collider: its world bounds and its layers
+    struct BroadphaseProxy {
+        GameObject *gameObject;
+        AABB bounds;
+        uint32_t layers;        // the layers the object is part of
+        uint32_t collidesWith;  // union of the collision masks of those layers
+        bool awake;             // pairs of two sleeping proxies are not reported
+    };
+
+    // A uniform grid over the XZ plane. The maps are planar, so there is no point in
+    // splitting on Y. The grid covers a bounded area; anything outside of it is clamped
+    // to the border cells, so it still works, only slower.
+    // The grid is rebuilt from scratch every frame with a counting sort, which keeps all
+    // the memory in a few vectors that are reused between frames.
+    class UniformGrid
+    {
+    public:
+        UniformGrid();
+
+        void SetBounds(glm::vec2 min, glm::vec2 max, float cellSize);
+        void Build(const std::vector<BroadphaseProxy> &proxies);
+        // appends every pair of proxies (by index) whose bounds overlap and whose layers
+        // can collide; each pair is reported exactly once
+        void QueryPairs(const std::vector<BroadphaseProxy> &proxies,
+                        std::vector<std::pair<int, int>> &pairs) const;
+
+    private:
+        int CellX(float x) const;
+        int CellZ(float z) const;
+
+        glm::vec2 min, max;
+        float cellSize;
+        int cellsX, cellsZ;
+
+        std::vector<int> cellStart;    // cellsX * cellsZ + 1 offsets into cellEntries
+        std::vector<int> cellEntries;  // proxy indices, grouped by cell
+    };
+}
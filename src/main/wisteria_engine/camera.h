@@ -12,7 +12,7 @@ namespace engine
             : GameObject(pos, glm::vec3(1), glm::quatLookAt(-forward, up))
         // quatLookAt's default looking direction is -Z but gameobjects look at +Z
         {
-            viewMatrix = glm::lookAt(position, position + this->forward, this->up);
+            OnTransformChange();
             projectionMatrix = glm::perspective(glm::radians(60.0f), 4.0f / 3.0f, 0.1f, 1000.0f);
         }
 
@@ -26,8 +26,9 @@ namespace engine
             projectionMatrix = glm::ortho(left, right, bottom, top, near, far);
         }
 
-        glm::mat4 GetViewMatrix() const
+        glm::mat4 GetViewMatrix()
         {
+            UpdateTransform();
             return viewMatrix;
         }
 
@@ -38,19 +39,20 @@ namespace engine
 
         void RotateAround(float distance, float angle, glm::vec3 localAxis)
         {
-            Translate(distance * forward);
+            Translate(distance * GetForward());
             Rotate(glm::angleAxis(angle, localAxis));
-            Translate(-distance * forward);
+            Translate(-distance * GetForward());
         }
 
         void RotateAround(float distance, float angle)
         {
-            RotateAround(distance, angle, up);
+            RotateAround(distance, angle, GetUp());
         }
 
         void OnTransformChange() override
         {
-            viewMatrix = glm::lookAt(position, position + forward, up);
+            glm::vec3 position = GetPosition();
+            viewMatrix = glm::lookAt(position, position + GetForward(), GetUp());
         }
 
         bool IsOrthographic() const
@@ -75,9 +77,10 @@ namespace engine
             viewportHeight = height;
         }
 
-        glm::vec4 GetPositionGeneralized() const
+        glm::vec4 GetPositionGeneralized()
         {
-            return glm::vec4(isOrthographic ? forward : position, !isOrthographic);
+            UpdateTransform();
+            return glm::vec4(isOrthographic ? GetForward() : GetPosition(), !isOrthographic);
         }
 
         float viewportX = 0;
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include "collisionworld3d.h"
+#include "gameobject3d.h"
+
+using namespace engine;
+
+// how much the bounds of dynamic colliders are fattened in the tree. Bigger margins
+// mean fewer reinsertions but more candidate pairs
+#define AABB_TREE_MARGIN 1.0f
+// a collider falls asleep after its bounds moved less than SLEEP_TOLERANCE for SLEEP_FRAMES
+// collision steps in a row
+#define SLEEP_FRAMES 30
+#define SLEEP_TOLERANCE 1e-4f
+
+void CollisionWorld::AddCollider(GameObject *gameObject)
+{
+    if (gameObject->hitArea == nullptr || gameObject->broadphaseProxy != AABB_TREE_NULL_NODE)
+        return;
+
+    float margin = gameObject->bodyType == BODY_STATIC ? 0.0f : AABB_TREE_MARGIN;
+    gameObject->UpdateTransform();
+    gameObject->sweepStart = gameObject->hitArea->center;
+    gameObject->broadphaseProxy = tree.CreateProxy(gameObject->hitArea->GetBounds(),
+                                                   gameObject, margin);
+    gameObject->collisionWorld = this;
+    gameObject->sleeping = false;
+    gameObject->idleFrames = 0;
+    gameObject->sleepBounds = gameObject->hitArea->GetBounds();
+    if (gameObject->bodyType != BODY_STATIC) {
+        gameObject->colliderIndex = (int)dynamicColliders.size();
+        dynamicColliders.push_back(gameObject);
+    }
+    QueryStaticPairs(gameObject->broadphaseProxy);
+}
+
+void CollisionWorld::RemoveCollider(GameObject *gameObject)
+{
+    int proxyId = gameObject->broadphaseProxy;
+    if (proxyId == AABB_TREE_NULL_NODE)
+        return;
+
+    auto involvesProxy = [proxyId](const std::pair<int, int> &pair) {
+        return pair.first == proxyId || pair.second == proxyId;
+    };
+    staticPairs.erase(std::remove_if(staticPairs.begin(), staticPairs.end(), involvesProxy),
+                      staticPairs.end());
+    newStaticPairs.erase(std::remove_if(newStaticPairs.begin(), newStaticPairs.end(), involvesProxy),
+                         newStaticPairs.end());
+    if (gameObject->colliderMoved) {
+        movedColliders.erase(std::remove(movedColliders.begin(), movedColliders.end(), gameObject),
+                             movedColliders.end());
+        gameObject->colliderMoved = false;
+    }
+    if (gameObject->colliderIndex >= 0) {
+        // swap-remove from the dynamic colliders
+        GameObject *last = dynamicColliders.back();
+        dynamicColliders[gameObject->colliderIndex] = last;
+        last->colliderIndex = gameObject->colliderIndex;
+        dynamicColliders.pop_back();
+        gameObject->colliderIndex = -1;
+    }
+
+    tree.DestroyProxy(proxyId);
+    gameObject->broadphaseProxy = AABB_TREE_NULL_NODE;
+    gameObject->collisionWorld = nullptr;
+}
+
+void CollisionWorld::SetLayerMask(GameObject *gameObject, uint32_t layerMask)
+{
+    bool hadLayers = gameObject->layerMask != 0;
+    gameObject->layerMask = layerMask;
+    if (!hadLayers && layerMask != 0)
+        AddCollider(gameObject);
+    else if (hadLayers && layerMask == 0)
+        RemoveCollider(gameObject);
+}
+
+void CollisionWorld::MarkMoved(GameObject *gameObject)
+{
+    if (gameObject->colliderMoved || gameObject->broadphaseProxy == AABB_TREE_NULL_NODE)
+        return;
+    gameObject->colliderMoved = true;
+    movedColliders.push_back(gameObject);
+}
+
+void CollisionWorld::BeginStep()
+{
+    GameObject::UpdateTransforms();
+    for (auto gameObject : dynamicColliders)
+        gameObject->sweepStart = gameObject->hitArea->center;
+}
+
+void CollisionWorld::Wake(GameObject *gameObject)
+{
+    if (!gameObject->sleeping)
+        return;
+    gameObject->sleeping = false;
+    gameObject->idleFrames = 0;
+}
+
+// the bounds are compared against the ones from when the collider stopped moving, so
+// a slow drift still wakes it up eventually
+void CollisionWorld::UpdateSleep(GameObject *gameObject, const AABB &bounds)
+{
+    glm::vec3 tolerance = glm::vec3(SLEEP_TOLERANCE);
+    const AABB &still = gameObject->sleepBounds;
+    if (glm::all(glm::lessThanEqual(glm::abs(bounds.min - still.min), tolerance)) &&
+        glm::all(glm::lessThanEqual(glm::abs(bounds.max - still.max), tolerance))) {
+        if (++gameObject->idleFrames >= SLEEP_FRAMES)
+            gameObject->sleeping = true;
+        return;
+    }
+    gameObject->sleepBounds = bounds;
+    gameObject->idleFrames = 0;
+    gameObject->sleeping = false;
+}
+
+AABB CollisionWorld::SweptBounds(GameObject *gameObject)
+{
+    AABB bounds = gameObject->hitArea->GetBounds();
+    if (!gameObject->continuousCollision)
+        return bounds;
+    glm::vec3 offset = gameObject->sweepStart - gameObject->hitArea->center;
+    return AABB::Union(bounds, AABB(bounds.min + offset, bounds.max + offset));
+}
+
+void CollisionWorld::QueryStaticPairs(int proxyId)
+{
+    GameObject *gameObject = tree.GetGameObject(proxyId);
+    tree.Query(tree.GetFatAABB(proxyId), [&](int otherId) {
+        GameObject *other = tree.GetGameObject(otherId);
+        // moving pairs are the grid's job, static ones never collide and neither do
+        // static and kinematic ones
+        bool isStatic = gameObject->bodyType == BODY_STATIC;
+        bool otherStatic = other->bodyType == BODY_STATIC;
+        if (isStatic == otherStatic ||
+            gameObject->bodyType == BODY_KINEMATIC || other->bodyType == BODY_KINEMATIC)
+            return true;
+        if (isStatic)
+            newStaticPairs.emplace_back(otherId, proxyId);
+        else
+            newStaticPairs.emplace_back(proxyId, otherId);
+        return true;
+    });
+}
+
+// refits the colliders that moved since the last frame. Only the ones that left their
+// fat AABB are reinserted, and only those can start overlapping a new static collider
+void CollisionWorld::UpdateTree()
+{
+    for (auto gameObject : movedColliders) {
+        gameObject->colliderMoved = false;
+        // refits the hitarea, if the transform is still dirty
+        gameObject->UpdateTransform();
+        float margin = gameObject->bodyType == BODY_STATIC ? 0.0f : AABB_TREE_MARGIN;
+        if (tree.MoveProxy(gameObject->broadphaseProxy, SweptBounds(gameObject), margin))
+            QueryStaticPairs(gameObject->broadphaseProxy);
+    }
+    movedColliders.clear();
+
+    if (!newStaticPairs.empty()) {
+        staticPairs.insert(staticPairs.end(), newStaticPairs.begin(), newStaticPairs.end());
+        std::sort(staticPairs.begin(), staticPairs.end());
+        staticPairs.erase(std::unique(staticPairs.begin(), staticPairs.end()), staticPairs.end());
+        newStaticPairs.clear();
+    }
+
+    // a cached pair lives for as long as the fat AABBs overlap
+    staticPairs.erase(std::remove_if(staticPairs.begin(), staticPairs.end(),
+        [this](const std::pair<int, int> &pair) {
+            return !tree.GetFatAABB(pair.first).Overlaps(tree.GetFatAABB(pair.second));
+        }), staticPairs.end());
+}
+
+uint32_t CollisionWorld::CollidesWith(uint32_t layerMask, const std::vector<int> &collisionMasks)
+{
+    uint32_t collidesWith = 0;
+    for (int layer = 0; layerMask != 0; ++layer, layerMask >>= 1) {
+        if (layerMask & 1)
+            collidesWith |= (uint32_t)collisionMasks[layer];
+    }
+    return collidesWith;
+}
+
+void CollisionWorld::FindPairs(const std::vector<int> &collisionMasks,
+                               std::vector<std::pair<GameObject *, GameObject *>> &pairs)
+{
+    UpdateTree();
+
+    // tight bounds of the dynamic colliders, in the same order as dynamicColliders
+    proxies.clear();
+    for (auto gameObject : dynamicColliders) {
+        AABB bounds = SweptBounds(gameObject);
+        UpdateSleep(gameObject, bounds);
+        uint32_t layerMask = gameObject->layerMask;
+        proxies.push_back({gameObject, bounds, layerMask,
+                           CollidesWith(layerMask, collisionMasks), !gameObject->sleeping});
+    }
+
+    for (auto [dynamicId, staticId] : staticPairs) {
+        GameObject *dynamicObject = tree.GetGameObject(dynamicId);
+        GameObject *staticObject = tree.GetGameObject(staticId);
+        if (dynamicObject->sleeping)
+            continue;
+        const BroadphaseProxy &proxy = proxies[dynamicObject->colliderIndex];
+        uint32_t staticLayers = staticObject->layerMask;
+        if ((proxy.collidesWith & staticLayers) == 0 &&
+            (CollidesWith(staticLayers, collisionMasks) & proxy.layers) == 0)
+            continue;
+        // the static fat AABB is the tight one
+        if (proxy.bounds.Overlaps(tree.GetFatAABB(staticId)))
+            pairs.emplace_back(dynamicObject, staticObject);
+    }
+
+    gridPairs.clear();
+    grid.Build(proxies);
+    grid.QueryPairs(proxies, gridPairs);
+    for (auto [index1, index2] : gridPairs) {
+        GameObject *gameObject1 = proxies[index1].gameObject;
+        GameObject *gameObject2 = proxies[index2].gameObject;
+        if (gameObject1->bodyType == BODY_KINEMATIC && gameObject2->bodyType == BODY_KINEMATIC)
+            continue;
+        pairs.emplace_back(gameObject1, gameObject2);
+    }
+}
+
+// the queries refresh the tree first, since gameobjects can move between two collision steps
+
+bool CollisionWorld::CastSphere(const Ray &ray, float radius, RaycastHit &hit, uint32_t layers)
+{
+    glm::vec3 end = ray.origin + glm::normalize(ray.direction) * ray.maxDistance;
+    float closest = 1;
+    hit.gameObject = nullptr;
+    tree.RayCast(ray.origin, end, radius, [&](int proxyId, float maxFraction) {
+        GameObject *gameObject = tree.GetGameObject(proxyId);
+        float toi;
+        if ((gameObject->layerMask & layers) == 0 || gameObject == ray.ignore ||
+            !gameObject->hitArea->SweepSphere(ray.origin, end, radius, toi) || toi > maxFraction)
+            return maxFraction;
+        hit.gameObject = gameObject;
+        closest = toi;
+        return toi;
+    });
+    if (hit.gameObject == nullptr)
+        return false;
+
+    glm::vec3 center = ray.origin + (end - ray.origin) * closest;
+    hit.normal = hit.gameObject->hitArea->GetNormal(center);
+    hit.point = center - hit.normal * radius;
+    hit.distance = closest * ray.maxDistance;
+    return true;
+}
+
+bool CollisionWorld::Raycast(const Ray &ray, RaycastHit &hit, uint32_t layers)
+{
+    UpdateTree();
+    return CastSphere(ray, 0, hit, layers);
+}
+
+bool CollisionWorld::SphereCast(const Ray &ray, float radius, RaycastHit &hit, uint32_t layers)
+{
+    UpdateTree();
+    return CastSphere(ray, radius, hit, layers);
+}
+
+void CollisionWorld::RaycastBatch(const std::vector<Ray> &rays, std::vector<RaycastHit> &hits,
+                                  uint32_t layers)
+{
+    UpdateTree();
+    hits.resize(rays.size());
+    for (size_t i = 0; i < rays.size(); ++i)
+        CastSphere(rays[i], 0, hits[i], layers);
+}
+
+void CollisionWorld::OverlapSphere(glm::vec3 center, float radius, std::vector<GameObject *> &results,
+                                   uint32_t layers)
+{
+    UpdateTree();
+    tree.Query(AABB(center - glm::vec3(radius), center + glm::vec3(radius)), [&](int proxyId) {
+        GameObject *gameObject = tree.GetGameObject(proxyId);
+        float toi;
+        // a sweep that doesn't move only hits what it starts in
+        if ((gameObject->layerMask & layers) != 0 &&
+            gameObject->hitArea->SweepSphere(center, center, radius, toi))
+            results.push_back(gameObject);
+        return true;
+    });
+}
+
+void CollisionWorld::OverlapBox(glm::vec3 center, glm::vec3 halfSize, std::vector<GameObject *> &results,
+                                uint32_t layers)
+{
+    UpdateTree();
+    tree.Query(AABB(center - halfSize, center + halfSize), [&](int proxyId) {
+        GameObject *gameObject = tree.GetGameObject(proxyId);
+        if ((gameObject->layerMask & layers) != 0 && gameObject->hitArea->OverlapsBox(center, halfSize))
+            results.push_back(gameObject);
+        return true;
+    });
+}
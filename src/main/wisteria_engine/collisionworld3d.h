@@ -0,0 +1,107 @@
+#pragma once
+#include <vector>
+#include "broadphase3d.h"
+#include "aabbtree3d.h"
+
+#define ALL_LAYERS 0xFFFFFFFFu
+
+namespace engine
+{
+    class GameObject;
+
+    // static colliders never move after they are added to a layer: they are put in the
+    // broadphase once and never tested against each other.
+    // kinematic colliders are moved by code and only collide with dynamic ones.
+    // dynamic colliders collide with everything.
+    // Kinematic and dynamic colliders fall asleep when their bounds haven't changed for
+    // a while, and pairs where neither side is awake are skipped
+    enum BodyType { BODY_STATIC, BODY_KINEMATIC, BODY_DYNAMIC };
+
+    struct Ray {
+        glm::vec3 origin;
+        glm::vec3 direction;  // doesn't have to be normalized, but can't be zero
+        float maxDistance;
+        // left out, so a cast from a gameobject (line of sight from a tank) doesn't stop
+        // at the gameobject itself
+        GameObject *ignore = nullptr;
+    };
+
+    struct RaycastHit {
+        GameObject *gameObject = nullptr;  // null if nothing was hit
+        glm::vec3 point = glm::vec3(0);
+        glm::vec3 normal = glm::vec3(0);
+        float distance = 0;
+    };
+
+    // The broadphase of a scene. Every collider lives in a dynamic AABB tree:
+    // static ones are inserted once, dynamic ones with fattened bounds that are
+    // refit only when the gameobject moves out of them. Static-vs-dynamic pairs
+    // are found incrementally from the tree, by the colliders that moved, and
+    // cached between frames. Dynamic-vs-dynamic pairs come from a uniform grid
+    // that is rebuilt every frame from the dynamic colliders only.
+    class CollisionWorld
+    {
+    public:
+        // the collider must have its hit area set and be in at least one layer
+        void AddCollider(GameObject *gameObject);
+        void RemoveCollider(GameObject *gameObject);
+        // bit i is set if the gameobject is in layer i. The collider joins the broadphase
+        // with its first layer and leaves it with its last
+        void SetLayerMask(GameObject *gameObject, uint32_t layerMask);
+        // called by the gameobject whenever its transform changes
+        void MarkMoved(GameObject *gameObject);
+        // called at the start of every simulation step, records where the colliders start moving
+        // from for the swept tests
+        void BeginStep();
+        // wakes up a sleeping collider; the scene does it for everything an awake
+        // collider runs into
+        void Wake(GameObject *gameObject);
+
+        // fills pairs with the gameobjects whose bounds overlap and whose layers can
+        // collide, according to collisionMasks (see ControlledScene3D)
+        void FindPairs(const std::vector<int> &collisionMasks,
+                       std::vector<std::pair<GameObject *, GameObject *>> &pairs);
+
+        // scene queries, answered by the tree. Only the colliders in at least one of the
+        // given layers are considered. Casts report the first hit, 0 away if they start
+        // inside a collider other than the ray's ignore
+        bool Raycast(const Ray &ray, RaycastHit &hit, uint32_t layers = ALL_LAYERS);
+        bool SphereCast(const Ray &ray, float radius, RaycastHit &hit, uint32_t layers = ALL_LAYERS);
+        // the results are appended
+        void OverlapSphere(glm::vec3 center, float radius, std::vector<GameObject *> &results,
+                           uint32_t layers = ALL_LAYERS);
+        void OverlapBox(glm::vec3 center, glm::vec3 halfSize, std::vector<GameObject *> &results,
+                        uint32_t layers = ALL_LAYERS);
+        // hits[i] is the first hit of rays[i]. The tree is refreshed once for all of them,
+        // but each ray still walks the tree on its own, like Raycast, and leaves out its
+        // own ignore (bots cast from a different tank each)
+        void RaycastBatch(const std::vector<Ray> &rays, std::vector<RaycastHit> &hits,
+                          uint32_t layers = ALL_LAYERS);
+
+        // set its bounds to the playable area of the map
+        UniformGrid grid;
+        DynamicAABBTree tree;
+
+    private:
+        void UpdateTree();
+        bool CastSphere(const Ray &ray, float radius, RaycastHit &hit, uint32_t layers);
+        void QueryStaticPairs(int proxyId);
+        // the bounds of the collider, grown to cover this step's motion for the
+        // continuous ones
+        static AABB SweptBounds(GameObject *gameObject);
+        static void UpdateSleep(GameObject *gameObject, const AABB &bounds);
+        static uint32_t CollidesWith(uint32_t layerMask, const std::vector<int> &collisionMasks);
+
+        std::vector<GameObject *> dynamicColliders;
+        std::vector<GameObject *> movedColliders;
+
+        // (dynamic proxy, static proxy), sorted and kept between frames for as long as
+        // their fat AABBs overlap
+        std::vector<std::pair<int, int>> staticPairs;
+        std::vector<std::pair<int, int>> newStaticPairs;
+
+        // kept between frames so the collision step doesn't allocate
+        std::vector<BroadphaseProxy> proxies;
+        std::vector<std::pair<int, int>> gridPairs;
+    };
+}
@@ -0,0 +1,57 @@
+#include "contactsolver3d.h"
+#include "gameobject3d.h"
+
+using namespace engine;
+
+int ContactSolver::GetBody(GameObject *gameObject)
+{
+    if (gameObject->solverBody == -1) {
+        gameObject->solverBody = (int)bodies.size();
+        bodies.push_back({gameObject, glm::vec3(0)});
+    }
+    return gameObject->solverBody;
+}
+
+void ContactSolver::Add(GameObject *gameObject, GameObject *other, glm::vec3 push)
+{
+    float depth = glm::length(push);
+    if (depth == 0)
+        return;
+    constraints.push_back({GetBody(gameObject), other, -1, push / depth, depth});
+}
+
+void ContactSolver::Solve(int iterations)
+{
+    // whether the other side moves is only known once every handler had its say
+    for (auto &constraint : constraints)
+        constraint.otherBody = constraint.other->solverBody;
+
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        for (auto &constraint : constraints) {
+            Body &body = bodies[constraint.body];
+            glm::vec3 otherCorrection = constraint.otherBody == -1 ?
+                glm::vec3(0) : bodies[constraint.otherBody].correction;
+            float remaining = constraint.depth -
+                glm::dot(body.correction - otherCorrection, constraint.direction);
+            if (remaining <= 0)
+                continue;
+
+            if (constraint.otherBody == -1) {
+                body.correction += constraint.direction * remaining;
+            } else {
+                body.correction += constraint.direction * (remaining / 2);
+                bodies[constraint.otherBody].correction -= constraint.direction * (remaining / 2);
+            }
+        }
+    }
+
+    for (auto &body : bodies) {
+        body.gameObject->solverBody = -1;
+        if (body.correction == glm::vec3(0))
+            continue;
+        body.gameObject->Translate(body.correction);
+        body.gameObject->OnPositionCorrection(body.correction);
+    }
+    bodies.clear();
+    constraints.clear();
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+
+#include "utils/glm_utils.h"
+
+// more iterations settle piles of contacts better; a few are plenty for the game
+#define CONTACT_SOLVER_ITERATIONS 4
+
+namespace engine
+{
+    class GameObject;
+
+    // Position correction for the contacts of a collision step. Collision handlers say
+    // how they want their gameobject pushed out of others, instead of moving it on the
+    // spot, and the solver works out the pushes for all the contacts at once.
+    // Each push is a constraint: the gameobject must move at least depth along direction,
+    // relative to the other one. The constraints are relaxed one after the other, a few
+    // times over (Gauss-Seidel), so a gameobject against a corner ends up out of both
+    // walls, and two gameobjects pushing out of each other split the push. Gameobjects
+    // that don't push out of anything aren't moved. In the end every gameobject that
+    // has to move is translated once
+    class ContactSolver
+    {
+    public:
+        // push is how far and which way the gameobject should move to get out of other
+        void Add(GameObject *gameObject, GameObject *other, glm::vec3 push);
+        // moves the gameobjects and forgets the constraints
+        void Solve(int iterations = CONTACT_SOLVER_ITERATIONS);
+
+    private:
+        struct Body {
+            GameObject *gameObject;
+            glm::vec3 correction;
+        };
+        struct Constraint {
+            int body;
+            GameObject *other;
+            int otherBody;  // -1 if the other gameobject doesn't move
+            glm::vec3 direction;
+            float depth;
+        };
+
+        int GetBody(GameObject *gameObject);
+
+        // kept between steps so they don't allocate
+        std::vector<Body> bodies;
+        std::vector<Constraint> constraints;
+    };
+}
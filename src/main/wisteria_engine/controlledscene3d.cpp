@@ -29,11 +29,10 @@ MessageCallback(GLenum source,
 
 ControlledScene3D::ControlledScene3D()
 {
-    gameObjects.reserve(70);
+    gameObjects.Reserve(70);
     toDestroy.reserve(10);
     // usually a scene doesn't have more than a main camera and a secondary one
     cameras.reserve(2);
-    layers.assign(32, std::unordered_set<GameObject *>());
     collisionMasks.assign(32, 0);
 
     glEnable(GL_DEBUG_OUTPUT);
@@ -45,47 +44,25 @@ ControlledScene3D::~ControlledScene3D()
     for (auto &gameObject : gameObjects)
         delete gameObject;
 
-    gameObjects.clear();
+    gameObjects.Clear();
     toDestroy.clear();
     cameras.clear();
+    if (cameraBuffer != 0)
+        glDeleteBuffers(1, &cameraBuffer);
 }
 
-void ControlledScene3D::RenderMesh(Mesh *mesh, Shader *shader, const glm::mat4 &modelMatrix)
+void ControlledScene3D::UploadCameraUniforms()
 {
-    if (!mesh || !shader || !shader->program)
-        return;
-
-    // Render an object using the specified shader and the specified position
-    shader->Use();
-    GLuint loc_view_matrix = glGetUniformLocation(shader->program, "WIST_VIEW_MATRIX");
-    GLuint loc_projection_matrix = glGetUniformLocation(shader->program, "WIST_PROJECTION_MATRIX");
-    GLuint loc_model_matrix = glGetUniformLocation(shader->program, "WIST_MODEL_MATRIX");
-    GLuint loc_mvp_matrix = glGetUniformLocation(shader->program, "WIST_MVP");
-    GLuint loc_eye_pos = glGetUniformLocation(shader->program, "WIST_EYE_POSITION");
-
-    glUniformMatrix4fv(loc_view_matrix, 1, GL_FALSE, glm::value_ptr(mainCamera->GetViewMatrix()));
-    glUniformMatrix4fv(loc_projection_matrix, 1, GL_FALSE, glm::value_ptr(mainCamera->GetProjectionMatrix()));
-    glUniformMatrix4fv(loc_model_matrix, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-    if (loc_mvp_matrix != -1) {
-        // only compute the MVP matrix if the shader uses it
-        glm::mat4 mvp = mainCamera->GetProjectionMatrix() * mainCamera->GetViewMatrix() * modelMatrix;
-        glUniformMatrix4fv(loc_mvp_matrix, 1, GL_FALSE, glm::value_ptr(mvp));
-    }
-    if (loc_eye_pos != -1) {
-        glUniform4fv(loc_eye_pos, 1, glm::value_ptr(mainCamera->GetPositionGeneralized()));
-    }
-
-    mesh->UseMaterials(false); // To whoever wrote gfxc: I hate you for this. Took me 3 days to figure out why my textures weren't working!!
-    mesh->Render();
-}
-
-void ControlledScene3D::RenderMeshCustomMaterial(Mesh *mesh, Material material, const glm::mat4 &modelMatrix)
-{
-    if (!mesh || !material.shader || !material.shader->GetProgramID())
-        return;
-
-    material.Use();
-    RenderMesh(mesh, material.shader, modelMatrix);
+    CameraUniforms uniforms;
+    uniforms.view = mainCamera->GetViewMatrix();
+    uniforms.projection = mainCamera->GetProjectionMatrix();
+    uniforms.eyePosition = mainCamera->GetPositionGeneralized();
+    view = uniforms.view;
+    viewProjection = uniforms.projection * uniforms.view;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraUniforms), &uniforms);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 void ControlledScene3D::FrameStart()
@@ -93,6 +70,7 @@ void ControlledScene3D::FrameStart()
     // Clears the color buffer (using the previously set color) and depth buffer
     glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    Material::ForgetBindings();
 }
 
 void ControlledScene3D::Init()
@@ -111,6 +89,13 @@ void ControlledScene3D::Init()
     //glViewport(0, 0, windowResolution.x, windowResolution.y);
     ResizeDrawArea();
 
+    // bound once; every shader reads the camera from it, see Assets::LoadShader
+    glGenBuffers(1, &cameraBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, WIST_CAMERA_BINDING, cameraBuffer);
+
     Assets::lookupDirectory = PATH_JOIN(window->props.selfDir, SOURCE_PATH::MAIN, "wisteria_engine", "shaders");
     Assets::AddPath("Default.VS", "Default.VS.glsl");
     Assets::AddPath("Default.VertexColor.FS", "Default.VertexColor.FS.glsl");
@@ -128,7 +113,8 @@ void ControlledScene3D::Init()
 
 void ControlledScene3D::AddToScene(GameObject *gameObject)
 {
-    gameObjects.insert(gameObject);
+    if (!gameObjects.Contains(gameObject->handle))
+        gameObject->handle = gameObjects.Insert(gameObject);
     gameObject->scene = this;
     for (auto &child : gameObject->GetChildren()) {
         AddToScene(child);
@@ -137,41 +123,122 @@ void ControlledScene3D::AddToScene(GameObject *gameObject)
 
 void ControlledScene3D::Destroy(GameObject *gameObject)
 {
-    toDestroy.insert(gameObject);
+    toDestroy.push_back(gameObject->handle);
     for (auto &child : gameObject->GetChildren()) {
         Destroy(child);
     }
 }
 
+void ControlledScene3D::Destroy(Handle handle)
+{
+    if (GameObject *gameObject = Get(handle))
+        Destroy(gameObject);
+}
+
+GameObject *ControlledScene3D::Get(Handle handle)
+{
+    GameObject **gameObject = gameObjects.Get(handle);
+    return gameObject == nullptr ? nullptr : *gameObject;
+}
+
 void ControlledScene3D::AddToLayer(GameObject *gameObject, int layer)
 {
-    if (layer > 32) {
+    if (layer < 0 || layer >= 32) {
         std::cerr << "Wisteria Engine only supports 32 layers.\n";
         exit(1);
     }
-    layers[layer].insert(gameObject);
+    if (gameObject->layerMask & (1u << layer))
+        return;
+    if (!gameObjects.Contains(gameObject->handle)) {
+        std::cerr << "Add the gameobject to the scene before adding it to a layer.\n";
+        exit(1);
+    }
+
+    Layer &members = layers[layer];
+    uint32_t slot = gameObject->handle.index;
+    if (slot >= members.indices.size())
+        members.indices.resize(slot + 1);
+    members.indices[slot] = (uint32_t)members.gameObjects.size();
+    members.gameObjects.push_back(gameObject);
+    collisionWorld.SetLayerMask(gameObject, gameObject->layerMask | (1u << layer));
 }
 
 void ControlledScene3D::RemoveFromLayer(GameObject *gameObject, int layer)
 {
-    if (layer > 32) {
+    if (layer < 0 || layer >= 32) {
         std::cerr << "Wisteria Engine only supports 32 layers.\n";
         exit(1);
     }
-    layers[layer].erase(gameObject);
+    if (!(gameObject->layerMask & (1u << layer)))
+        return;
+
+    Layer &members = layers[layer];
+    uint32_t index = members.indices[gameObject->handle.index];
+    GameObject *last = members.gameObjects.back();
+    members.gameObjects[index] = last;
+    members.indices[last->handle.index] = index;
+    members.gameObjects.pop_back();
+    collisionWorld.SetLayerMask(gameObject, gameObject->layerMask & ~(1u << layer));
 }
 
-struct pair_hash {
-    inline std::size_t operator()(const std::pair<GameObject *, GameObject *> &v) const {
-        return reinterpret_cast<uintptr_t>(v.first) ^ reinterpret_cast<uintptr_t>(v.second);
-    }
-};
+void ControlledScene3D::PushOut(GameObject *gameObject, GameObject *other, glm::vec3 push)
+{
+    contactSolver.Add(gameObject, other, push);
+}
+
+bool ControlledScene3D::Raycast(const Ray &ray, RaycastHit &hit, uint32_t layers)
+{
+    return collisionWorld.Raycast(ray, hit, layers);
+}
+
+bool ControlledScene3D::SphereCast(const Ray &ray, float radius, RaycastHit &hit, uint32_t layers)
+{
+    return collisionWorld.SphereCast(ray, radius, hit, layers);
+}
+
+void ControlledScene3D::OverlapSphere(glm::vec3 center, float radius,
+                                      std::vector<GameObject *> &results, uint32_t layers)
+{
+    collisionWorld.OverlapSphere(center, radius, results, layers);
+}
+
+void ControlledScene3D::OverlapBox(glm::vec3 center, glm::vec3 halfSize,
+                                   std::vector<GameObject *> &results, uint32_t layers)
+{
+    collisionWorld.OverlapBox(center, halfSize, results, layers);
+}
+
+void ControlledScene3D::RaycastBatch(const std::vector<Ray> &rays, std::vector<RaycastHit> &hits,
+                                     uint32_t layers)
+{
+    collisionWorld.RaycastBatch(rays, hits, layers);
+}
 
 void ControlledScene3D::Update(float deltaTimeSeconds)
 {
     deltaTime = deltaTimeSeconds * timeScale;
     unscaledDeltaTime = deltaTimeSeconds;
 
+    // collisions are handled once per step too, so a frame without steps doesn't dispatch
+    // the same contacts again, and tanks can't move several steps into each other before
+    // they're pushed apart
+    float stepTime = 1.0f / simulationRate;
+    simulationTime += deltaTimeSeconds;
+    int steps = 0;
+    for (; simulationTime >= stepTime && steps < maxSimulationSteps; ++steps) {
+        collisionWorld.BeginStep();
+        Simulate(stepTime);
+        CheckCollisions();
+        // so what a step destroyed doesn't collide again in the next one
+        DestroyPending();
+        simulationTime -= stepTime;
+    }
+    // too far behind (a breakpoint, dragging the window), so don't try to catch up
+    if (simulationTime >= stepTime)
+        simulationTime = glm::mod(simulationTime, stepTime);
+    GameObject::transforms.UpdateRenderMatrices(simulationTime / stepTime);
+
+    renderStats = RenderQueue::Stats();
     for (auto &camera : cameras) {
         // if (!camera->active)
         //     continue;
@@ -182,85 +249,117 @@ void ControlledScene3D::Update(float deltaTimeSeconds)
                    drawAreaY + (int)(mainCamera->viewportY * drawAreaHeight),
                    (int)(mainCamera->viewportWidth * drawAreaWidth), 
                    (int)(mainCamera->viewportHeight * drawAreaHeight));
-        for (auto gameObject : gameObjects) {
-            DrawGameObject(gameObject);
-        }
+        UploadCameraUniforms();
+        // works for the orthographic minimap too, the planes come from the matrix
+        Frustum frustum(viewProjection);
+        // gameObjects has the children too, so none of them is queued by its parent
+        for (auto gameObject : gameObjects)
+            QueueGameObject(gameObject, frustum);
+        renderQueue.Submit(viewProjection, renderStats);
     }
     mainCamera = cameras[0];
 
     Tick();
+    DestroyPending();
+}
 
-    CheckCollisions();
-    
-    for (auto gameObject : toDestroy) {
-        if (gameObjects.find(gameObject) == gameObjects.end())
+void ControlledScene3D::DestroyPending()
+{
+    // a handle that is already invalid was destroyed earlier in the loop, or isn't in the scene
+    for (auto handle : toDestroy) {
+        GameObject *gameObject = Get(handle);
+        if (gameObject == nullptr)
             continue;
 
-        gameObjects.erase(gameObject);
-        for (int layer = 0; layer < 32; ++layer)
-            RemoveFromLayer(gameObject, layer);
+        for (uint32_t layers = gameObject->layerMask; layers != 0; layers &= layers - 1)
+            RemoveFromLayer(gameObject, glm::findLSB(layers));
+        gameObjects.Remove(handle);
 
         delete gameObject;
     }
     toDestroy.clear();
 }
 
-void ControlledScene3D::CheckCollisions()
+void ControlledScene3D::Simulate(float stepTime)
 {
-    std::unordered_set<std::pair<GameObject *, GameObject *>, pair_hash> pairs;
-    for (int layer1 = 0; layer1 < 32; ++layer1) {
-        for (int layer2 = layer1; layer2 < 32; ++layer2) {
-            if ((collisionMasks[layer1] & (1 << layer2)) == 0)
-                continue;
-            
-            for (auto gameObject1 : layers[layer1]) {
-                for (auto gameObject2 : layers[layer2]) {
-                    if (gameObject1 == gameObject2 ||
-                        pairs.find({gameObject1, gameObject2}) != pairs.end()) continue;
-                    
-                    std::unique_ptr<CollisionEvent> event1, event2;
-                    pairs.insert(std::make_pair(gameObject1, gameObject2));
-                    if (gameObject1->Collides(gameObject2, event1, event2)) {
-                        event1->Dispatch(gameObject1);
-                        event2->Dispatch(gameObject2);
-                    }
-                }
-            }
-        }
+    GameObject::transforms.ClearStepMotion();
+    for (auto gameObject : gameObjects) {
+        float objectDeltaTime = gameObject->useUnscaledTime ? stepTime : stepTime * timeScale;
+        SimulateGameObject(gameObject, objectDeltaTime);
     }
 }
 
-void ControlledScene3D::DrawGameObject(GameObject *gameObject)
+void ControlledScene3D::SimulateGameObject(GameObject *gameObject, float deltaTime)
 {
-    if (gameObject->mesh) {
-        glm::mat4 modelMatrix = gameObject->ObjectToWorldMatrix();
-        if (gameObject->material.shader) {
-            RenderMeshCustomMaterial(gameObject->mesh, gameObject->material, modelMatrix);
-        } else {
-            RenderMesh(gameObject->mesh, Assets::shaders["VertexColor"], modelMatrix);
-        }
-    }
-
-    float objectDeltaTime = gameObject->useUnscaledTime ? unscaledDeltaTime : deltaTime;
     if (gameObject->acceleration != glm::vec3(0)) {
-        gameObject->velocity += gameObject->acceleration * objectDeltaTime;
+        gameObject->velocity += gameObject->acceleration * deltaTime;
     }
+    glm::vec3 translation = glm::vec3(0);
+    glm::quat rotation = QUAT1;
     if (gameObject->velocity != glm::vec3(0)) {
-        glm::vec3 position = gameObject->GetLocalPosition();
-        position += gameObject->velocity * objectDeltaTime;
-        gameObject->SetLocalPosition(position);
+        translation = gameObject->velocity * deltaTime;
+        gameObject->SetLocalPosition(gameObject->GetLocalPosition() + translation);
     }
     if (gameObject->angularVelocity != glm::vec3(0)) {
-        glm::quat rotation = gameObject->GetLocalRotation();
         float angularSpeed = glm::length(gameObject->angularVelocity);
         glm::vec3 axis = gameObject->angularVelocity / angularSpeed;
-        rotation = glm::rotate(rotation, angularSpeed * objectDeltaTime, axis);
-        gameObject->SetLocalRotation(rotation);
+        rotation = glm::angleAxis(angularSpeed * deltaTime, axis);
+        gameObject->SetLocalRotation(gameObject->GetLocalRotation() * rotation);
     }
+    // so drawing can interpolate over the step
+    if (translation != glm::vec3(0) || rotation != QUAT1)
+        GameObject::transforms.SetStepMotion(gameObject->transformIndex, translation, rotation);
+}
 
-    for (auto &child : gameObject->GetChildren()) {
-        DrawGameObject(child);
+void ControlledScene3D::CheckCollisions()
+{
+    // the narrowphase reads transforms from its worker threads, so every transform
+    // that changed this step is calculated here, once
+    GameObject::UpdateTransforms();
+
+    collisionPairs.clear();
+    collisionWorld.FindPairs(collisionMasks, collisionPairs);
+
+    // narrowphase first, into the contact buffer; events are only made for real contacts
+    narrowphase.Run(collisionPairs, contacts);
+
+    // only pairs with an awake side get this far, so whatever sleeps here was run into
+    for (auto &contact : contacts) {
+        collisionWorld.Wake(contact.gameObject1);
+        collisionWorld.Wake(contact.gameObject2);
+    }
+
+    for (auto &contact : contacts)
+        contact.Dispatch();
+    contactSolver.Solve();
+}
+
+void ControlledScene3D::QueueGameObject(GameObject *gameObject, const Frustum &frustum)
+{
+    if (!gameObject->mesh)
+        return;
+
+    // meshes without bounds are always drawn
+    glm::vec4 bounds = GameObject::transforms.renderBounds[gameObject->transformIndex];
+    if (bounds.w >= 0 && !frustum.IntersectsSphere(glm::vec3(bounds), bounds.w)) {
+        ++renderStats.culled;
+        return;
     }
+
+    Shader *shader = gameObject->material.shader;
+    const Material *material = &gameObject->material;
+    if (!shader) {
+        shader = Assets::shaders["VertexColor"];
+        material = nullptr;
+    }
+    if (!shader || !shader->program)
+        return;
+
+    // distance along the camera's forward direction, the view space z flipped
+    glm::mat4 modelMatrix = gameObject->RenderMatrix();
+    float depth = -(view * modelMatrix[3]).z;
+    renderQueue.Add(gameObject->renderPass, gameObject->mesh, shader, material, modelMatrix, depth);
+    ++renderStats.visible;
 }
 
 void ControlledScene3D::OnInputUpdate(float deltaTime, int mods)
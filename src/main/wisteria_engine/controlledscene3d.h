@@ -1,13 +1,21 @@
 #pragma once
 #include <set>
-#include <unordered_set>
 #include <unordered_map>
 #include "gameobject3d.h"
+#include "collisionworld3d.h"
+#include "narrowphase3d.h"
+#include "contactsolver3d.h"
+#include "renderqueue3d.h"
+#include "frustum3d.h"
+#include "slotmap.h"
 #include "camera.h"
 #include "meshplusplus.h"
 
 #include "components/simple_scene.h"
 
+#define SIMULATION_RATE 60.0f
+#define MAX_SIMULATION_STEPS 5
+
 namespace engine
 {
     class ControlledScene3D : public gfxc::SimpleScene
@@ -18,9 +26,34 @@ namespace engine
         void Init() override;
 
         void AddToScene(GameObject *gameObject);
+        // gameobjects are destroyed at the end of the frame, along with their children
         void Destroy(GameObject *gameObject);
+        void Destroy(Handle handle);
+        // nullptr if the gameobject was destroyed
+        GameObject *Get(Handle handle);
+        // the gameobject must be in the scene already
         void AddToLayer(GameObject *gameObject, int layer);
         void RemoveFromLayer(GameObject *gameObject, int layer);
+        // the gameobjects in a layer, in no particular order
+        const std::vector<GameObject *> &GetLayer(int layer) const { return layers[layer].gameObjects; }
+
+        // for collision handlers: move gameObject by push to get it out of other. The
+        // pushes of a collision step are resolved together once all the events were
+        // dispatched, see ContactSolver
+        void PushOut(GameObject *gameObject, GameObject *other, glm::vec3 push);
+
+        // scene queries, see CollisionWorld
+        bool Raycast(const Ray &ray, RaycastHit &hit, uint32_t layers = ALL_LAYERS);
+        bool SphereCast(const Ray &ray, float radius, RaycastHit &hit, uint32_t layers = ALL_LAYERS);
+        void OverlapSphere(glm::vec3 center, float radius, std::vector<GameObject *> &results,
+                           uint32_t layers = ALL_LAYERS);
+        void OverlapBox(glm::vec3 center, glm::vec3 halfSize, std::vector<GameObject *> &results,
+                        uint32_t layers = ALL_LAYERS);
+        void RaycastBatch(const std::vector<Ray> &rays, std::vector<RaycastHit> &hits,
+                          uint32_t layers = ALL_LAYERS);
+
+        // culling, binds and draws of the last frame, all cameras together
+        const RenderQueue::Stats &GetRenderStats() const { return renderStats; }
 
     protected:
         virtual void Initialize() {}; 
@@ -33,33 +66,73 @@ namespace engine
     private:
         void FrameStart() override;
         void Update(float deltaTimeSeconds) override;
+        void Simulate(float stepTime);
+        void SimulateGameObject(GameObject *gameObject, float deltaTime);
         void CheckCollisions();
+        void DestroyPending();
         void OnInputUpdate(float deltaTime, int mods) override;
         // void FrameEnd() override;
 
         void ResizeDrawArea();
         void OnWindowResize(int width, int height) override;
         
-        void RenderMesh(Mesh *mesh, Shader *shader, const glm::mat4 &modelMatrix);
-        void RenderMeshCustomMaterial(Mesh *mesh, Material material, const glm::mat4 &modelMatrix);
-        void DrawGameObject(GameObject *gameObject);
+        // fills the camera uniform buffer, once per camera
+        void UploadCameraUniforms();
+        // nothing is queued if the gameobject is outside the frustum
+        void QueueGameObject(GameObject *gameObject, const Frustum &frustum);
 
     protected:
         glm::vec4 clearColor = glm::vec4(0, 0, 0, 1);
-        std::unordered_set<GameObject *> gameObjects;
+        SlotMap<GameObject *> gameObjects;
         float deltaTime;
         float unscaledDeltaTime;
         float timeScale = 1;
+        // the simulation (velocities, accelerations, then collisions) runs in fixed steps
+        // of real time, as many as fit in a frame, up to maxSimulationSteps; the rest of
+        // a long frame is dropped. Drawing interpolates between the last two steps
+        float simulationRate = SIMULATION_RATE;  // steps per second
+        int maxSimulationSteps = MAX_SIMULATION_STEPS;
         glm::ivec2 windowResolution;
 
         std::vector<Camera *> cameras;
         Camera *mainCamera;
         int drawAreaX, drawAreaY, drawAreaWidth, drawAreaHeight;
 
+        // collisionMasks[i] has bit j set if objects in layer i collide with objects
+        // in layer j. A pair is tested if either of the two layers asks for it
         std::vector<int> collisionMasks;
+        CollisionWorld collisionWorld;
 
     private:
-        std::unordered_set<GameObject *> toDestroy;
-        std::vector<std::unordered_set<GameObject *>> layers;
+        float simulationTime = 0;  // real time not simulated yet, less than a step
+        std::vector<Handle> toDestroy;  // may repeat, the destroy loop skips repeats
+
+        // Which layers a gameobject is in is its layerMask; this is just for iterating
+        // over a layer. A sparse set: indices[handle index] is where the gameobject is
+        // in gameObjects, which stays packed by moving the last one into any hole
+        struct Layer
+        {
+            std::vector<GameObject *> gameObjects;
+            std::vector<uint32_t> indices;
+        };
+        Layer layers[32];
+
+        // the WIST_CAMERA uniform block, in std140 layout
+        struct CameraUniforms
+        {
+            glm::mat4 view;
+            glm::mat4 projection;
+            glm::vec4 eyePosition;
+        };
+        GLuint cameraBuffer = 0;
+        glm::mat4 view = glm::mat4(1), viewProjection = glm::mat4(1);
+        RenderQueue renderQueue;
+        RenderQueue::Stats renderStats;
+
+        // kept between frames so the collision step doesn't allocate
+        std::vector<std::pair<GameObject *, GameObject *>> collisionPairs;
+        std::vector<Contact> contacts;
+        ParallelNarrowphase narrowphase;
+        ContactSolver contactSolver;
     };
 } // namespace engine
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "frustum3d.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WIST_FRUSTUM_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace engine;
+
+Frustum::Frustum(const glm::mat4 &viewProjection)
+{
+    // a point is inside if -w <= x, y, z <= w in clip space; each of the six is a row of
+    // the matrix plus or minus the last one (Gribb and Hartmann)
+    glm::mat4 m = glm::transpose(viewProjection);
+    glm::vec4 planes[6] = {
+        m[3] + m[0], m[3] - m[0],
+        m[3] + m[1], m[3] - m[1],
+        m[3] + m[2], m[3] - m[2],
+    };
+    for (int i = 0; i < 8; ++i) {
+        glm::vec4 plane = planes[i < 6 ? i : 5];
+        plane /= glm::length(glm::vec3(plane));
+        planeX[i] = plane.x;
+        planeY[i] = plane.y;
+        planeZ[i] = plane.z;
+        planeW[i] = plane.w;
+    }
+}
+
+bool Frustum::IntersectsSphere(glm::vec3 center, float radius) const
+{
+#ifdef WIST_FRUSTUM_SSE
+    // signed distances to 4 planes at once, and whether any is below -radius
+    __m128 x = _mm_set1_ps(center.x);
+    __m128 y = _mm_set1_ps(center.y);
+    __m128 z = _mm_set1_ps(center.z);
+    __m128 minusRadius = _mm_set1_ps(-radius);
+    for (int group = 0; group < 8; group += 4) {
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(planeX + group), x),
+                                                _mm_mul_ps(_mm_load_ps(planeY + group), y)),
+                                     _mm_add_ps(_mm_mul_ps(_mm_load_ps(planeZ + group), z),
+                                                _mm_load_ps(planeW + group)));
+        if (_mm_movemask_ps(_mm_cmplt_ps(distance, minusRadius)) != 0)
+            return false;
+    }
+    return true;
+#else
+    for (int i = 0; i < 6; ++i) {
+        float distance = planeX[i] * center.x + planeY[i] * center.y + planeZ[i] * center.z + planeW[i];
+        if (distance < -radius)
+            return false;
+    }
+    return true;
+#endif
+}
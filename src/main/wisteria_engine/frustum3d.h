@@ -0,0 +1,28 @@
+#pragma once
+
+#include "utils/glm_utils.h"
+
+namespace engine
+{
+    // The six planes of a camera's view volume, taken straight from its view projection
+    // matrix, so perspective and orthographic cameras work the same. The planes are
+    // normalized and face inwards, and kept one coordinate per array, so a sphere is
+    // tested against four planes at a time
+    class Frustum
+    {
+    public:
+        Frustum() = default;
+        explicit Frustum(const glm::mat4 &viewProjection);
+
+        // false only if the sphere is entirely outside one of the planes. Spheres near a
+        // corner can pass without being inside, which only means drawing a bit more
+        bool IntersectsSphere(glm::vec3 center, float radius) const;
+
+    private:
+        // 6 planes, plus 2 copies of the last one so both groups of 4 are full
+        alignas(16) float planeX[8];
+        alignas(16) float planeY[8];
+        alignas(16) float planeZ[8];
+        alignas(16) float planeW[8];
+    };
+}
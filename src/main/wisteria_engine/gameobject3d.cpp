@@ -1,12 +1,21 @@
 #include <iostream>
 #include <unordered_map>
 #include <unordered_set>
+#include <algorithm>
 #include "hitarea3d.h"
 #include "gameobject3d.h"
 #include "transform3d.h"
 
 using namespace engine;
 
+uint32_t GameObject::nextId = 0;
+TransformStore GameObject::transforms;
+SlabAllocator GameObject::allocator;
+
+void *GameObject::operator new(size_t size) { return allocator.Allocate(size); }
+void GameObject::operator delete(void *block, size_t size) { allocator.Free(block, size); }
+const SlabAllocator::Stats &GameObject::GetAllocatorStats() { return allocator.GetStats(); }
+
 // private constructor
 GameObject::GameObject(GameObject *parent, Mesh *mesh, glm::vec3 position, 
                        glm::vec3 scale, glm::quat rotation)
@@ -14,25 +23,20 @@ GameObject::GameObject(GameObject *parent, Mesh *mesh, glm::vec3 position,
     this->mesh = mesh;
     this->parent = parent;
     if (parent != nullptr)
-        parent->children.insert(this);
+        parent->children.push_back(this);
 
-    SetLocalPositionDirty(position);
-    SetLocalScaleDirty(scale);
-    SetLocalRotationDirty(rotation);
-
-    RecalculateMatrix();
+    transformIndex = transforms.Add(this, parent == nullptr ? -1 : parent->transformIndex,
+                                    position, scale, rotation);
+    // resolved right away, so the world rotation is right if fixedRotation is set next
+    UpdateTransform();
 }
 
 GameObject::GameObject()
 {
-    position = glm::vec3(0);
-    localPosition = glm::vec3(0);
-    rotation = QUAT1;
-    localRotation = QUAT1;
-    pseudoScale = glm::vec3(1);
-    localScale = glm::vec3(1);
     parent = nullptr;
     mesh = nullptr;
+    transformIndex = transforms.Add(this, -1, glm::vec3(0), glm::vec3(1), QUAT1);
+    UpdateTransform();
 }
 
 GameObject::GameObject(Mesh *mesh, glm::vec3 position, glm::vec3 scale, glm::quat rotation)
@@ -43,13 +47,20 @@ GameObject::GameObject(glm::vec3 position, glm::vec3 scale, glm::quat rotation)
 
 GameObject::~GameObject()
 {
+    if (collisionWorld != nullptr) {
+        collisionWorld->RemoveCollider(this);
+    }
     if (parent != nullptr) {
         parent->DetachChild(this);
     }
     for (auto child : children) {
         child->parent = nullptr;
+        transforms.SetParent(child->transformIndex, -1);
+        child->MarkTransformDirty();
     }
     children.clear();
+    transforms.Remove(transformIndex);
+    delete hitArea;
 }
 
 GameObject *GameObject::CreateChild(Mesh *mesh, glm::vec3 position, 
@@ -64,195 +75,153 @@ GameObject *GameObject::CreateChild(glm::vec3 position,
     return new GameObject(parent, nullptr, position, scale, rotation);
 }
 
-std::unordered_set<GameObject *> &GameObject::GetChildren()
+std::vector<GameObject *> &GameObject::GetChildren()
 {
     return children;
 }
 
 void GameObject::AddChild(GameObject *child, bool keepWorldPosition)
 {
+    // the transform of the child under its old parent
+    glm::vec3 childPosition = child->GetPosition();
+    glm::quat childRotation = child->GetRotation();
+    glm::vec3 childScale = child->GetPseudoScale();
+    glm::quat childLocalRotation = child->GetLocalRotation();
     if (child->parent != nullptr)
         child->parent->DetachChild(child);
 
-    children.insert(child);
+    children.push_back(child);
 
     child->parent = this;
+    transforms.SetParent(child->transformIndex, transformIndex);
     if (keepWorldPosition) {
-        // trigger a recalculation of the child's local position and rotation
-        child->SetPositionDirty(child->position);
-        child->SetRotationDirty(child->rotation);
-        child->SetPseudoScaleDirty(child->pseudoScale);
+        // recalculate the child's local position and rotation
+        child->SetPosition(childPosition);
+        child->SetRotation(childRotation);
+        // the world scale of the child stays the same, so its children's local scale does too
+        child->SetLocalScale(childScale / GetPseudoScale());
     } else {
-        // trigger a recalculation of the child's world position and rotation
-        child->SetLocalPositionDirty(child->localPosition);
-        child->SetLocalRotationDirty(child->localRotation);
-        child->SetLocalScaleDirty(child->localScale);
+        // recalculate the child's world position and rotation
+        child->SetLocalRotation(childLocalRotation);
     }
-    RecalculateMatrix();
 }
 
 void GameObject::DetachChild(GameObject *child)
 {
-    children.erase(child);
+    children.erase(std::find(children.begin(), children.end(), child));
     child->parent = nullptr;
+    transforms.SetParent(child->transformIndex, -1);
+    child->MarkTransformDirty();
 }
 
-glm::vec3 GameObject::GetLocalPosition() { return localPosition; }
-glm::quat GameObject::GetLocalRotation() { return localRotation; }
-glm::vec3 GameObject::GetLocalScale() { return localScale; }
-glm::vec3 GameObject::GetPosition() { return position; }
-glm::quat GameObject::GetRotation() { return rotation; }
-glm::vec3 GameObject::GetPseudoScale() { return pseudoScale; }
+glm::vec3 GameObject::GetLocalPosition() { return transforms.localPositions[transformIndex]; }
+glm::quat GameObject::GetLocalRotation() { UpdateTransform(); return transforms.localRotations[transformIndex]; }
+glm::vec3 GameObject::GetLocalScale() { return transforms.localScales[transformIndex]; }
+glm::vec3 GameObject::GetPosition() { UpdateTransform(); return transforms.positions[transformIndex]; }
+glm::quat GameObject::GetRotation() { UpdateTransform(); return transforms.rotations[transformIndex]; }
+glm::vec3 GameObject::GetPseudoScale() { UpdateTransform(); return transforms.pseudoScales[transformIndex]; }
 
-void GameObject::SetLocalPositionDirty(glm::vec3 newLocalPos)
+// The local transform is what gets stored (but the world rotation of fixedRotation
+// objects), the world one is only calculated when it is read, or for everything at
+// once in UpdateTransforms. Moving an object a few times in a frame only marks its
+// subtree once
+void GameObject::MarkTransformDirty()
 {
-    localPosition = newLocalPos;
-    if (parent == nullptr) {
-        position = newLocalPos;
-    } else {
-        glm::vec3 disp = parent->pseudoScale * newLocalPos;
-        disp = parent->rotation * disp;
-        position = parent->position + disp;
-    }
-
+    transforms.dirty[transformIndex] = true;
     for (auto child : children)
-    {
-        child->SetLocalPositionDirty(child->localPosition);
-    }
+        if (!transforms.dirty[child->transformIndex])
+            child->MarkTransformDirty();
+
+    // the collider is refit lazily, at the next collision check
+    if (collisionWorld != nullptr)
+        collisionWorld->MarkMoved(this);
 }
-void GameObject::SetLocalPosition(glm::vec3 newLocalPos)
+
+void GameObject::UpdateTransform()
 {
-    SetLocalPositionDirty(newLocalPos);
-    RecalculateMatrix();
+    transforms.Resolve(transformIndex);
 }
 
-void GameObject::SetPositionDirty(glm::vec3 newPosition)
+void GameObject::UpdateTransforms()
 {
-    position = newPosition;
-    if (parent == nullptr) {
-        localPosition = newPosition;
-    } else {
-        glm::vec3 disp = newPosition - parent->position;
-        disp = glm::inverse(parent->rotation) * disp;
-        localPosition = disp / parent->pseudoScale;
-    }
-
-    for (auto child : children)
-    {
-        child->SetLocalPositionDirty(child->localPosition);
-    }
+    transforms.Update();
 }
-void GameObject::SetPosition(glm::vec3 newPosition)
+
+void GameObject::SetLocalPosition(glm::vec3 newLocalPos)
 {
-    SetPositionDirty(newPosition);
-    RecalculateMatrix();
+    transforms.localPositions[transformIndex] = newLocalPos;
+    MarkTransformDirty();
 }
 
-void GameObject::SetLocalScaleDirty(glm::vec3 newLocalScale)
+void GameObject::SetPosition(glm::vec3 newPosition)
 {
-    localScale = newLocalScale;
-    pseudoScale = (parent == nullptr) ? newLocalScale : newLocalScale * parent->pseudoScale;
-    for (auto child : children)
-    {
-        child->SetLocalScaleDirty(child->localScale);
+    glm::vec3 localPosition = newPosition;
+    if (parent != nullptr) {
+        glm::vec3 disp = newPosition - parent->GetPosition();
+        disp = glm::conjugate(parent->GetRotation()) * disp;
+        localPosition = disp / parent->GetPseudoScale();
     }
+    transforms.localPositions[transformIndex] = localPosition;
+    MarkTransformDirty();
 }
+
 void GameObject::SetLocalScale(glm::vec3 newLocalScale)
 {
-    SetLocalScaleDirty(newLocalScale);
-    RecalculateMatrix();
+    transforms.localScales[transformIndex] = newLocalScale;
+    MarkTransformDirty();
 }
 
-void GameObject::SetPseudoScaleDirty(glm::vec3 newPseudoScale)
-{
-    pseudoScale = newPseudoScale;
-    localScale = (parent == nullptr) ? newPseudoScale : newPseudoScale / parent->pseudoScale;
-    for (auto child : children)
-    {
-        child->SetPseudoScaleDirty(child->pseudoScale);
-    }
-}
 void GameObject::SetPseudoScale(glm::vec3 newPseudoScale)
 {
-    SetPseudoScaleDirty(newPseudoScale);
-    RecalculateMatrix();
-}
+    // the children keep their world scale
+    for (auto child : children)
+        child->UpdateTransform();
 
-void GameObject::SetLocalRotationDirty(glm::quat newLocalRotation)
-{
-    localRotation = newLocalRotation;
-    rotation = ((parent == nullptr) ? QUAT1 : parent->rotation) * newLocalRotation;
-    forward = rotation * glm::vec3_forward;
-    right = rotation * glm::vec3_right;
-    up = rotation * glm::vec3_up;
+    glm::vec3 localScale = newPseudoScale;
+    if (parent != nullptr)
+        localScale = newPseudoScale / parent->GetPseudoScale();
+    transforms.localScales[transformIndex] = localScale;
     for (auto child : children)
-    {
-        if (child->fixedRotation)
-            child->SetRotationDirty(child->rotation);
-        else
-            child->SetLocalRotationDirty(child->localRotation);
-        child->SetLocalPositionDirty(child->localPosition);
-    }
+        transforms.localScales[child->transformIndex] = 
+            transforms.pseudoScales[child->transformIndex] / newPseudoScale;
+    MarkTransformDirty();
 }
+
 void GameObject::SetLocalRotation(glm::quat newLocalRotation)
 {
-    SetLocalRotationDirty(newLocalRotation);
-    RecalculateMatrix();
+    transforms.localRotations[transformIndex] = newLocalRotation;
+    if (fixedRotation)
+        transforms.rotations[transformIndex] = 
+            (parent == nullptr ? QUAT1 : parent->GetRotation()) * newLocalRotation;
+    MarkTransformDirty();
 }
 
-void GameObject::SetRotationDirty(glm::quat newRotation)
-{
-    rotation = newRotation;
-    localRotation = ((parent == nullptr) ? QUAT1 : glm::inverse(parent->rotation)) * newRotation;
-    forward = rotation * glm::vec3_forward;
-    right = rotation * glm::vec3_right;
-    up = rotation * glm::vec3_up;
-    for (auto child : children)
-    {
-        if (child->fixedRotation)
-            child->SetRotationDirty(child->rotation);
-        else
-            child->SetLocalRotationDirty(child->localRotation);
-        child->SetLocalPositionDirty(child->localPosition);
-    }
-}
 void GameObject::SetRotation(glm::quat newRotation)
 {
-    SetRotationDirty(newRotation);
-    RecalculateMatrix();
+    transforms.localRotations[transformIndex] = 
+        (parent == nullptr ? QUAT1 : glm::conjugate(parent->GetRotation())) * newRotation;
+    transforms.rotations[transformIndex] = newRotation;
+    MarkTransformDirty();
 }
 
-glm::vec3 GameObject::GetForward() { return forward; }
-glm::vec3 GameObject::GetRight() { return right; }
-glm::vec3 GameObject::GetUp() { return up; }
-
-void GameObject::RecalculateMatrix()
-{
-    objectToWorldMatrix = (parent == nullptr ? glm::mat4(1) : parent->objectToWorldMatrix) *
-        transform::Translate(localPosition) * 
-        transform::Rotate(localRotation) * 
-        transform::Scale(localScale);
-
-    OnTransformChange();
-
-    for (auto child : children)
-        child->RecalculateMatrix();
-}
+glm::vec3 GameObject::GetForward() { return GetRotation() * glm::vec3_forward; }
+glm::vec3 GameObject::GetRight() { return GetRotation() * glm::vec3_right; }
+glm::vec3 GameObject::GetUp() { return GetRotation() * glm::vec3_up; }
 
 void GameObject::Translate(glm::vec3 translation, bool local)
 {
     if (local)
-        SetLocalPosition(localPosition + translation);
+        SetLocalPosition(GetLocalPosition() + translation);
     else
-        SetPosition(position + translation);
+        SetPosition(GetPosition() + translation);
 }
 
 void GameObject::Rotate(glm::quat rotation, bool local)
 {
     if (local)
-        SetLocalRotation(rotation * this->localRotation);
+        SetLocalRotation(rotation * GetLocalRotation());
     else {
-        SetRotation(rotation * this->rotation);
+        SetRotation(rotation * GetRotation());
     }
 }
 
@@ -264,23 +233,24 @@ void GameObject::Rotate(glm::vec3 eulerAngles, bool local)
 void GameObject::Scale(glm::vec3 scale, bool local)
 {
     if (local)
-        SetLocalScale(localScale * scale);
+        SetLocalScale(GetLocalScale() * scale);
     else
-        SetPseudoScale(pseudoScale * scale);
+        SetPseudoScale(GetPseudoScale() * scale);
 }
 
-glm::mat4 GameObject::ObjectToWorldMatrix() { return objectToWorldMatrix; }
+glm::mat4 GameObject::ObjectToWorldMatrix() { UpdateTransform(); return transforms.matrices[transformIndex]; }
+glm::mat4 GameObject::RenderMatrix() { return transforms.renderMatrices[transformIndex]; }
 
 glm::mat4 GameObject::WorldToObjectMatrix()
 {
     // since this operation is not very used, we can afford to compute it on demand
-    return glm::inverse(objectToWorldMatrix);
+    return transform::InverseAffine(ObjectToWorldMatrix());
 }
 
 // added for completeness; not used
 glm::vec3 GameObject::ObjectToWorldPosition(glm::vec3 point)
 {
-    return objectToWorldMatrix * glm::vec4(point, 1);
+    return ObjectToWorldMatrix() * glm::vec4(point, 1);
 }
 
 glm::vec3 GameObject::WorldToObjectPosition(glm::vec3 point)
@@ -288,20 +258,50 @@ glm::vec3 GameObject::WorldToObjectPosition(glm::vec3 point)
     return WorldToObjectMatrix() * glm::vec4(point, 1);
 }
 
+void GameObject::SetTag(const std::string &tag)
+{
+    tags = Tags::Mask(Tags::Id(tag));
+}
+
+bool GameObject::HasTag(const std::string &tag) const
+{
+    // a name that was never registered can't be on anything, and isn't registered here
+    int tagId = Tags::Find(tag);
+    return tagId != -1 && HasTag(tagId);
+}
+
+const std::string &GameObject::GetTag() const
+{
+    static const std::string noTag = "";
+    for (int tagId = 0; tagId < MAX_TAGS; ++tagId)
+        if (HasTag(tagId))
+            return Tags::Name(tagId);
+    return noTag;
+}
+
 const HitArea &GameObject::GetHitArea() { return *hitArea; }
 
 void GameObject::SetHitArea(Shape &&shape, glm::vec3 offset, 
                             glm::vec3 scale, glm::quat rotation)
 {
-    GameObject *support = new GameObject(this, nullptr, offset, scale, rotation);
-    hitArea = shape.CreateHitArea(support);
+    delete hitArea;
+    hitArea = shape.CreateHitArea(this);
+    hitArea->offset = offset;
+    hitArea->scale = scale;
+    hitArea->rotation = rotation;
+    UpdateTransform();
+    hitArea->Refit(GetPosition(), GetRotation(), GetPseudoScale());
+    if (collisionWorld != nullptr)
+        collisionWorld->MarkMoved(this);
 }
 
 bool GameObject::Contains(glm::vec3 point)
 {
-    if (hitArea->support == nullptr)
+    if (hitArea == nullptr)
         return false;
-    glm::vec3 objectPoint = hitArea->support->WorldToObjectPosition(point);
+    // into the space of the gameobject, then into the one of the hitarea
+    glm::vec3 objectPoint = WorldToObjectPosition(point);
+    objectPoint = glm::conjugate(hitArea->rotation) * (objectPoint - hitArea->offset) / hitArea->scale;
     return hitArea->Contains(objectPoint);
 }
 
@@ -312,15 +312,16 @@ bool GameObject::Contains(glm::vec3 point)
 // - This includes the parent's transformations
 // - Mirroring is OK
 // Failure to respect this contract will result in incorrect collision detection.
-bool GameObject::Collides(GameObject *other, CollisionEventPtr &event, CollisionEventPtr &otherEvent)
+bool GameObject::Collides(GameObject *other, Contact &contact)
 {
-    if (hitArea->support == nullptr || other->hitArea->support == nullptr)
+    if (hitArea == nullptr || other->hitArea == nullptr)
         return false;
 
-    bool collided = hitArea->Collides(other->hitArea, event, otherEvent);
-    event->gameObject = other;
-    otherEvent->gameObject = this;
-    return collided;
+    UpdateTransform();
+    other->UpdateTransform();
+    contact.gameObject1 = this;
+    contact.gameObject2 = other;
+    return hitArea->Collides(other->hitArea, contact);
 }
 
 void GameObject::SetBoxHitArea(float width, float height, float depth, glm::vec3 offset, 
@@ -332,14 +333,13 @@ void GameObject::SetBoxHitArea(float width, float height, float depth, glm::vec3
 void GameObject::SetSphereHitArea(float radius, glm::vec3 offset)
 {
     SetHitArea(SphereShape(radius), offset);
-    hitArea->support->fixedRotation = true;
 }
 
 GameObject *GameObject::InertDeepCopy(bool keepWorldPosition)
 {
     GameObject *copy = keepWorldPosition ? 
-        new GameObject(mesh, position, localScale, rotation) : 
-        new GameObject(mesh, localPosition, localScale, localRotation);
+        new GameObject(mesh, GetPosition(), GetLocalScale(), GetRotation()) : 
+        new GameObject(mesh, GetLocalPosition(), GetLocalScale(), GetLocalRotation());
 
     for (auto child : children)
         copy->AddChild(child->InertDeepCopy(false), false);
@@ -1,10 +1,16 @@
 #pragma once
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <functional>
 
 #include "material.h"
+#include "renderqueue3d.h"
 #include "hitarea3d.h"
+#include "collisionworld3d.h"
+#include "transformstore3d.h"
+#include "tags.h"
+#include "slotmap.h"
 
 #include "core/gpu/mesh.h"
 #include "utils/glm_utils.h"
@@ -13,8 +19,15 @@
 
 namespace engine
 {
+    class ControlledScene3D;
+
     class GameObject
     {
+        friend class ControlledScene3D;  // the scene keeps track of the layers
+        friend class CollisionWorld;
+        friend class Narrowphase;
+        friend class TransformStore;
+        friend class ContactSolver;
     public:
         GameObject();
         GameObject(Mesh *mesh, glm::vec3 position, glm::vec3 scale = glm::vec3(1),
@@ -22,6 +35,15 @@ namespace engine
         GameObject(glm::vec3 position, glm::vec3 scale = glm::vec3(1),
                    glm::quat rotation = QUAT1);
         virtual ~GameObject();
+        // a gameobject owns its slot in the transform store
+        GameObject(const GameObject &) = delete;
+        GameObject &operator=(const GameObject &) = delete;
+
+        // gameobjects of every type are spawned and destroyed all the time, so they
+        // come from a slab allocator instead of the system one
+        static void *operator new(size_t size);
+        static void operator delete(void *block, size_t size);
+        static const SlabAllocator::Stats &GetAllocatorStats();
 
         GameObject *CreateChild(Mesh *mesh, glm::vec3 position, 
                                 glm::vec3 scale = glm::vec3(1), glm::quat rotation = QUAT1);
@@ -33,9 +55,12 @@ namespace engine
         virtual void OnCollision(const SphereBoxCollisionEvent &collision) {};
         virtual void OnCollision(const SphereSphereCollisionEvent &collision) {};
         virtual void OnTransformChange() {};
+        // after the gameobject was moved by correction to get it out of what it collided
+        // with, see ControlledScene3D::PushOut
+        virtual void OnPositionCorrection(glm::vec3 correction) {};
 
         // children
-        std::unordered_set<GameObject *> &GetChildren();
+        std::vector<GameObject *> &GetChildren();
         void AddChild(GameObject *child, bool keepWorldPosition = true);
         void DetachChild(GameObject *child);
 
@@ -65,16 +90,24 @@ namespace engine
 
         // world transformations
         glm::mat4 ObjectToWorldMatrix();
+        // the object to world matrix to draw with, interpolated between the last two
+        // simulation steps of the scene; only valid while the scene draws
+        glm::mat4 RenderMatrix();
         glm::mat4 WorldToObjectMatrix();
         glm::vec3 ObjectToWorldPosition(glm::vec3 point);
         glm::vec3 WorldToObjectPosition(glm::vec3 point);
+        // calculates the world transform if it changed since the last call. The getters
+        // above do it on their own and the scene does it for everything once per frame
+        // with UpdateTransforms, before anything is read from other threads
+        void UpdateTransform();
+        static void UpdateTransforms();
 
         // hit area
         HitArea const &GetHitArea();
         void SetHitArea(Shape &&shape, glm::vec3 offset = glm::vec3(0),
                         glm::vec3 scale = glm::vec3(1), glm::quat rotation = QUAT1);
         bool Contains(glm::vec3 point);
-        bool Collides(GameObject *other, CollisionEventPtr &event, CollisionEventPtr &otherEvent);
+        bool Collides(GameObject *other, Contact &contact);
         void SetBoxHitArea(float width, float height, float depth, 
                            glm::vec3 offset = glm::vec3(0), 
                            glm::vec3 scale = glm::vec3(1), glm::quat rotation = QUAT1);
@@ -82,10 +115,21 @@ namespace engine
 
         GameObject *InertDeepCopy(bool keepWorldPosition = true);
 
+        // tags, see Tags. Use the ids in hot paths, the names are for convenience
+        void SetTag(const std::string &tag);  // replaces all the tags
+        void AddTag(const std::string &tag) { tags |= Tags::Mask(Tags::Id(tag)); }
+        void AddTag(int tagId) { tags |= Tags::Mask(tagId); }
+        void RemoveTag(int tagId) { tags &= ~Tags::Mask(tagId); }
+        bool HasTag(int tagId) const { return (tags & Tags::Mask(tagId)) != 0; }
+        bool HasTag(const std::string &tag) const;
+        // the name of the first tag, or "" if there are none
+        const std::string &GetTag() const;
+
         std::string name = "";
-        std::string tag = "";
+        TagMask tags = 0;
         Mesh *mesh = nullptr;
         Material material;
+        int renderPass = RENDER_PASS_OPAQUE;
         ControlledScene3D *scene = nullptr;
 
         glm::vec3 velocity = glm::vec3(0);
@@ -97,31 +141,50 @@ namespace engine
         // its parent gameobject is transformed
         bool fixedRotation = false;
 
+        // see BodyType. Must be set before adding the gameobject to a layer
+        BodyType bodyType = BODY_DYNAMIC;
+        bool IsSleeping() const { return sleeping; }
+
+        // ids are given in creation order and never reused, so they are the same from
+        // one run to the next; use them to order things deterministically
+        uint32_t GetId() const { return id; }
+        // the handle of the gameobject in its scene, null if it isn't in one. Keep this
+        // instead of a pointer to a gameobject that may get destroyed; see ControlledScene3D::Get
+        Handle GetHandle() const { return handle; }
+
+        // fast moving sphere colliders can opt into swept tests, so they can't tunnel
+        // through thin colliders when they move more than their size in a frame
+        bool continuousCollision = false;
+
     protected:
         GameObject(GameObject *parent, Mesh *mesh, glm::vec3 position, 
                    glm::vec3 scale = glm::vec3(1), glm::quat rotation = QUAT1);
 
-        void SetLocalPositionDirty(glm::vec3 position);
-        void SetLocalRotationDirty(glm::quat rotation);
-        void SetLocalScaleDirty(glm::vec3 scale);
-        void SetPositionDirty(glm::vec3 position);
-        void SetRotationDirty(glm::quat rotation);
-        void SetPseudoScaleDirty(glm::vec3 scale);
-        void RecalculateMatrix();
-
-        glm::vec3 localPosition = glm::vec3(0);
-        glm::vec3 localScale = glm::vec3(1);
-        glm::quat localRotation = QUAT1;
-        glm::vec3 position = glm::vec3(0);
-        glm::quat rotation = QUAT1;
-        glm::vec3 pseudoScale = glm::vec3(1);
-        glm::vec3 forward = glm::vec3_forward;
-        glm::vec3 right = glm::vec3_right;
-        glm::vec3 up = glm::vec3_up;
-        glm::mat4 objectToWorldMatrix = glm::mat4(1);
+        void MarkTransformDirty();
+
+        // where the transform is in the store; the store keeps it up to date
+        int transformIndex = -1;
+        static TransformStore transforms;
+        static SlabAllocator allocator;
+
+        uint32_t id = nextId++;
+        static uint32_t nextId;
+        Handle handle;
 
         GameObject *parent = nullptr;
-        HitArea *hitArea;
-        std::unordered_set<GameObject *> children;
+        HitArea *hitArea = nullptr;
+        uint32_t layerMask = 0;  // bit i is set if the object is in layer i
+
+        // broadphase bookkeeping, owned by the collision world
+        CollisionWorld *collisionWorld = nullptr;
+        int broadphaseProxy = AABB_TREE_NULL_NODE;
+        int colliderIndex = -1;
+        bool colliderMoved = false;
+        glm::vec3 sweepStart = glm::vec3(0);  // world position of the hitarea when the step started
+        bool sleeping = false;
+        int idleFrames = 0;
+        AABB sleepBounds;  // the bounds when the collider stopped moving
+        int solverBody = -1;  // owned by the contact solver, while it collects the pushes
+        std::vector<GameObject *> children;
     };
 }
\ No newline at end of file
@@ -4,34 +4,29 @@
 
 using namespace engine;
 
-std::unordered_map<HitArea::type_pair, HitArea::CollidesFunc, HitArea::pair_hash> HitArea::collisionFuncs;
+HitArea::CollidesFunc HitArea::collisionFuncs[MAX_SHAPE_TYPES][MAX_SHAPE_TYPES];
+SlabAllocator HitArea::allocator;
 
-bool HitArea::Collides(HitArea *other, CollisionEventPtr &event, CollisionEventPtr &otherEvent)
+int HitArea::NewShapeId()
 {
-    auto collisionFunc = collisionFuncs.find({GetType(), other->GetType()});
-    if (collisionFunc == collisionFuncs.end())
-        return false;
-    return (collisionFunc->second)(this, other, event, otherEvent);
-}
-
-void HitArea::RegisterCollisionFunc(std::type_index type1, std::type_index type2, 
-                                    CollidesFunc func)
-{
-    collisionFuncs[{type1, type2}] = func;
+    static int nextShapeId = 0;
+    if (nextShapeId >= MAX_SHAPE_TYPES) {
+        std::cerr << "Wisteria Engine only supports " << MAX_SHAPE_TYPES << " hitarea types.\n";
+        exit(1);
+    }
+    return nextShapeId++;
 }
 
-HitArea *BoxShape::CreateHitArea(GameObject *support)
+HitArea *BoxShape::CreateHitArea(GameObject *owner)
 {
-    return new BoxHitArea(support, *this);
+    return new BoxHitArea(owner, *this);
 }
 
 const BoxHitArea::init BoxHitArea::initializer;
 BoxHitArea::init::init()
 {
-    RegisterCollisionFunc(typeid(BoxHitArea), typeid(BoxHitArea), 
-                          (CollidesFunc)(&CollidesBoxBox));
-    RegisterCollisionFunc(typeid(BoxHitArea), typeid(SphereHitArea),
-                          (CollidesFunc)(&CollidesBoxSphere));
+    RegisterCollisionFunc<BoxHitArea, BoxHitArea, &CollidesBoxBox>();
+    RegisterCollisionFunc<BoxHitArea, SphereHitArea, &CollidesBoxSphere>();
 }
 
 bool BoxHitArea::Contains(glm::vec3 point)
@@ -41,64 +36,165 @@ bool BoxHitArea::Contains(glm::vec3 point)
            point.z >= -shape.depth  / 2 && point.z <= shape.depth  / 2;
 }
 
-bool engine::CollidesBoxBox(BoxHitArea *box1, BoxHitArea *box2, 
-                            CollisionEventPtr &event, CollisionEventPtr &otherEvent)
-{
-    glm::vec3 center = box1->support->GetPosition();
-    glm::vec3 otherCenter = box2->support->GetPosition();
-    float thisW = box1->shape.width * box1->support->GetPseudoScale().x;
-    float thisH = box1->shape.height * box1->support->GetPseudoScale().y;
-    float thisD = box1->shape.depth * box1->support->GetPseudoScale().z;
-    float otherW = box2->support->GetPseudoScale().x * box2->shape.width;
-    float otherH = box2->support->GetPseudoScale().y * box2->shape.height;
-    float otherD = box2->support->GetPseudoScale().z * box2->shape.depth;
-
-    event = std::make_unique<CollisionEvent>(box2->support);
-    otherEvent = std::make_unique<CollisionEvent>(box1->support);
-    return center.x - thisW / 2 <= otherCenter.x + otherW / 2 &&
-           center.x + thisW / 2 >= otherCenter.x - otherW / 2 && 
-           center.y - thisH / 2 <= otherCenter.y + otherH / 2 &&
-           center.y + thisH / 2 >= otherCenter.y - otherH / 2 &&
-           center.z - thisD / 2 <= otherCenter.z + otherD / 2 &&
-           center.z + thisD / 2 >= otherCenter.z - otherD / 2;
-}
-
-bool engine::CollidesBoxSphere(BoxHitArea *box, SphereHitArea *sphere, 
-                               CollisionEventPtr &event, CollisionEventPtr &otherEvent)
-{
-    glm::vec3 boxCenter = box->support->GetPosition();
-    glm::vec3 sphereCenter = sphere->support->GetPosition();
-    float radius = glm::abs(sphere->support->GetPseudoScale().x) * sphere->shape.radius;
-    float thisW = box->shape.width * box->support->GetPseudoScale().x;
-    float thisH = box->shape.height * box->support->GetPseudoScale().y;
-    float thisD = box->shape.depth * box->support->GetPseudoScale().z;
-
-    glm::vec3 closestPoint = glm::vec3(
-        glm::clamp(sphereCenter.x, boxCenter.x - thisW / 2, boxCenter.x + thisW / 2),
-        glm::clamp(sphereCenter.y, boxCenter.y - thisH / 2, boxCenter.y + thisH / 2),
-        glm::clamp(sphereCenter.z, boxCenter.z - thisD / 2, boxCenter.z + thisD / 2));
-    
+glm::vec3 BoxHitArea::GetHalfExtents(glm::vec3 worldScale)
+{
+    return glm::abs(glm::vec3(shape.width, shape.height, shape.depth) * worldScale) / 2.0f;
+}
+
+bool BoxHitArea::SweepSphere(glm::vec3 start, glm::vec3 end, float radius, float &toi)
+{
+    return SweepSphereBox(start, end, radius, center, halfExtents, toi);
+}
+
+bool BoxHitArea::OverlapsBox(glm::vec3 boxCenter, glm::vec3 halfSize)
+{
+    return GetBounds().Overlaps(AABB(boxCenter - halfSize, boxCenter + halfSize));
+}
+
+glm::vec3 BoxHitArea::GetNormal(glm::vec3 point)
+{
+    glm::vec3 halfSize = halfExtents;
+    glm::vec3 outside = point - ClosestPointOnBox(point, center, halfSize);
+    if (outside != glm::vec3(0))
+        return glm::normalize(outside);
+
+    // inside or on the surface: the face the point is closest to, relative to the size
+    glm::vec3 relative = (point - center) / halfSize;
+    int axis = 0;
+    for (int i = 1; i < 3; ++i) {
+        if (glm::abs(relative[i]) > glm::abs(relative[axis]))
+            axis = i;
+    }
+    glm::vec3 normal = glm::vec3(0);
+    normal[axis] = relative[axis] < 0 ? -1.0f : 1.0f;
+    return normal;
+}
+
+bool engine::CollidesBoxBox(BoxHitArea *box1, BoxHitArea *box2, Contact &contact)
+{
+    contact.type = Contact::GENERIC;
+    return box1->GetBounds().Overlaps(box2->GetBounds());
+}
+
+bool engine::CollidesBoxSphere(BoxHitArea *box, SphereHitArea *sphere, Contact &contact)
+{
+    glm::vec3 sphereCenter = sphere->center;
+    float radius = sphere->GetRadius();
+
+    glm::vec3 closestPoint = ClosestPointOnBox(sphereCenter, box->center, box->halfExtents);
     glm::vec3 displacement = sphereCenter - closestPoint;
     float distance = glm::length(displacement);
-    event = std::make_unique<SphereBoxCollisionEvent>(sphere->support, closestPoint, 
-                                                      displacement, distance);
-    otherEvent = std::make_unique<SphereBoxCollisionEvent>(box->support, closestPoint, 
-                                                           -displacement, distance);
+    contact.type = Contact::SPHERE_BOX;
+    contact.closestPoint = closestPoint;
+    contact.displacement = displacement;
+    contact.distance = distance;
     return distance <= radius;
 }
 
-HitArea *SphereShape::CreateHitArea(GameObject *support)
+// the segment is start + delta * t, for t in [0, 1]
+static bool SweepSegmentAABB(glm::vec3 start, glm::vec3 delta, glm::vec3 min, glm::vec3 max, float &t)
 {
-    return new SphereHitArea(support, *this);
+    float tMin = 0, tMax = 1;
+    for (int i = 0; i < 3; ++i) {
+        if (delta[i] == 0) {
+            if (start[i] < min[i] || start[i] > max[i])
+                return false;
+            continue;
+        }
+        float t1 = (min[i] - start[i]) / delta[i];
+        float t2 = (max[i] - start[i]) / delta[i];
+        tMin = glm::max(tMin, glm::min(t1, t2));
+        tMax = glm::min(tMax, glm::max(t1, t2));
+        if (tMin > tMax)
+            return false;
+    }
+    t = tMin;
+    return true;
+}
+
+// first root of |m + d * t|^2 = radius^2 in [0, 1], where m is the start relative to the center
+template <typename V>
+static bool SweepSegmentRound(V m, V d, float radius, float &t)
+{
+    float c = glm::dot(m, m) - radius * radius;
+    if (c <= 0) {
+        t = 0;
+        return true;
+    }
+    float a = glm::dot(d, d);
+    float b = glm::dot(m, d);
+    if (a == 0 || b >= 0)
+        return false;  // not moving, or moving away
+    float discriminant = b * b - a * c;
+    if (discriminant < 0)
+        return false;
+    t = (-b - glm::sqrt(discriminant)) / a;
+    return t <= 1;
+}
+
+// The box grown by the radius is a rounded box: the union of three slabs (the box grown
+// along a single axis), twelve cylinders around the edges and eight spheres at the corners.
+// The first time the segment enters any of them is the time of impact. The caps of the
+// cylinders are inside the corner spheres, so the cylinders can be taken as infinite and
+// only checked for the extent of their edge at the hit.
+bool engine::SweepSphereBox(glm::vec3 start, glm::vec3 end, float radius,
+                            glm::vec3 boxCenter, glm::vec3 halfSize, float &toi)
+{
+    glm::vec3 delta = end - start;
+    glm::vec3 min = boxCenter - halfSize;
+    glm::vec3 max = boxCenter + halfSize;
+    if (glm::length(start - ClosestPointOnBox(start, boxCenter, halfSize)) <= radius) {
+        toi = 0;
+        return true;
+    }
+    float t;
+    if (!SweepSegmentAABB(start, delta, min - radius, max + radius, t))
+        return false;
+
+    toi = 2;
+    for (int axis = 0; axis < 3; ++axis) {
+        glm::vec3 grow = glm::vec3(0);
+        grow[axis] = radius;
+        if (SweepSegmentAABB(start, delta, min - grow, max + grow, t))
+            toi = glm::min(toi, t);
+
+        int j = (axis + 1) % 3, k = (axis + 2) % 3;
+        for (float edgeJ : {min[j], max[j]}) {
+            for (float edgeK : {min[k], max[k]}) {
+                glm::vec2 m = glm::vec2(start[j] - edgeJ, start[k] - edgeK);
+                if (!SweepSegmentRound(m, glm::vec2(delta[j], delta[k]), radius, t))
+                    continue;
+                float along = start[axis] + delta[axis] * t;
+                if (along >= min[axis] && along <= max[axis])
+                    toi = glm::min(toi, t);
+            }
+        }
+    }
+    for (int corner = 0; corner < 8; ++corner) {
+        glm::vec3 point = glm::vec3(corner & 1 ? max.x : min.x,
+                                    corner & 2 ? max.y : min.y,
+                                    corner & 4 ? max.z : min.z);
+        if (SweepSegmentRound(start - point, delta, radius, t))
+            toi = glm::min(toi, t);
+    }
+    return toi <= 1;
+}
+
+bool engine::SweepSphereSphere(glm::vec3 start, glm::vec3 end, float radius,
+                               glm::vec3 center, float otherRadius, float &toi)
+{
+    return SweepSegmentRound(start - center, end - start, radius + otherRadius, toi);
+}
+
+HitArea *SphereShape::CreateHitArea(GameObject *owner)
+{
+    return new SphereHitArea(owner, *this);
 }
 
 const SphereHitArea::init SphereHitArea::initializer;
 SphereHitArea::init::init()
 {
-    RegisterCollisionFunc(typeid(SphereHitArea), typeid(SphereHitArea), 
-                          (CollidesFunc)(&CollidesSphereSphere));
-    RegisterCollisionFunc(typeid(SphereHitArea), typeid(BoxHitArea), 
-                          (CollidesFunc)(&CollidesSphereBox));
+    RegisterCollisionFunc<SphereHitArea, SphereHitArea, &CollidesSphereSphere>();
 }
 
 bool SphereHitArea::Contains(glm::vec3 point)
@@ -106,28 +202,57 @@ bool SphereHitArea::Contains(glm::vec3 point)
     return glm::distance(point, glm::vec3(0)) <= shape.radius;
 }
 
-bool engine::CollidesSphereSphere(SphereHitArea *sphere1, SphereHitArea *sphere2,
-                                  CollisionEventPtr &event, CollisionEventPtr &otherEvent)
+glm::vec3 SphereHitArea::GetHalfExtents(glm::vec3 worldScale)
+{
+    return glm::vec3(glm::abs(worldScale.x) * shape.radius);
+}
+
+bool SphereHitArea::SweepSphere(glm::vec3 start, glm::vec3 end, float radius, float &toi)
+{
+    return SweepSphereSphere(start, end, radius, center, GetRadius(), toi);
+}
+
+bool SphereHitArea::OverlapsBox(glm::vec3 boxCenter, glm::vec3 halfSize)
+{
+    return glm::length(center - ClosestPointOnBox(center, boxCenter, halfSize)) <= GetRadius();
+}
+
+glm::vec3 SphereHitArea::GetNormal(glm::vec3 point)
 {
-    glm::vec3 center = sphere1->support->GetPosition();
-    glm::vec3 otherCenter = sphere2->support->GetPosition();
-    float radius = glm::abs(sphere1->support->GetPseudoScale().x) * sphere1->shape.radius;
-    float otherRadius = glm::abs(sphere2->support->GetPseudoScale().x) * sphere2->shape.radius;
+    glm::vec3 direction = point - center;
+    return direction == glm::vec3(0) ? glm::vec3_up : glm::normalize(direction);
+}
 
-    glm::vec3 displacement = otherCenter - center;
+bool engine::CollidesSphereSphere(SphereHitArea *sphere1, SphereHitArea *sphere2, Contact &contact)
+{
+    glm::vec3 displacement = sphere2->center - sphere1->center;
     float distance = glm::length(displacement);
-    float sumRadius = radius + otherRadius;
-    event = std::make_unique<SphereSphereCollisionEvent>(sphere2->support, displacement, 
-                                                        distance, sumRadius);
-    otherEvent = std::make_unique<SphereSphereCollisionEvent>(sphere1->support, -displacement, 
-                                                              distance, sumRadius);
+    float sumRadius = sphere1->GetRadius() + sphere2->GetRadius();
+    contact.type = Contact::SPHERE_SPHERE;
+    contact.displacement = displacement;
+    contact.distance = distance;
+    contact.sumRadius = sumRadius;
     return distance <= sumRadius;
 }
 
-bool engine::CollidesSphereBox(SphereHitArea *sphere, BoxHitArea *box, 
-                               CollisionEventPtr &event, CollisionEventPtr &otherEvent)
+void Contact::Dispatch() const
 {
-    return CollidesBoxSphere(box, sphere, otherEvent, event);
+    // the concrete events are only reachable through the base class, which
+    // is the one that befriends the contact
+    auto dispatch = [this](CollisionEvent &&event1, CollisionEvent &&event2) {
+        event1.timeOfImpact = event2.timeOfImpact = timeOfImpact;
+        event1.Dispatch(gameObject1);
+        event2.Dispatch(gameObject2);
+    };
+    if (type == SPHERE_BOX) {
+        dispatch(SphereBoxCollisionEvent(gameObject2, closestPoint, displacement, distance),
+                 SphereBoxCollisionEvent(gameObject1, closestPoint, -displacement, distance));
+    } else if (type == SPHERE_SPHERE) {
+        dispatch(SphereSphereCollisionEvent(gameObject2, displacement, distance, sumRadius),
+                 SphereSphereCollisionEvent(gameObject1, -displacement, distance, sumRadius));
+    } else {
+        dispatch(CollisionEvent(gameObject2), CollisionEvent(gameObject1));
+    }
 }
 
 void CollisionEvent::Dispatch(GameObject *target)
@@ -1,121 +1,221 @@
 #pragma once
-#include <memory>
-#include <unordered_map>
-#include <typeindex>
+#include "broadphase3d.h"
+#include "slaballocator.h"
 #include "utils/glm_utils.h"
 
+#define MAX_SHAPE_TYPES 8
+
 namespace engine
 {
     struct HitArea;
     struct BoxHitArea;
     struct SphereHitArea;
+    struct Contact;
     class CollisionEvent;
     class SphereBoxCollisionEvent;
     class GameObject;
 
-    typedef std::unique_ptr<CollisionEvent> CollisionEventPtr;
-
     // a shape can be anything, but it must be able to create a hitarea
     struct Shape {
         virtual ~Shape() = default;
-        virtual HitArea *CreateHitArea(GameObject *support) = 0;
+        virtual HitArea *CreateHitArea(GameObject *owner) = 0;
+    };
+
+    // The result of a narrowphase test. Contacts are plain data, so the scene can keep
+    // them in a buffer that is reused every frame; the collision events are built from
+    // them, on the stack, only when a contact is dispatched.
+    // All the data is seen from gameObject1: displacement points towards gameObject2.
+    // gameObject2 gets the same contact with the displacement reversed.
+    struct Contact {
+        enum Type { GENERIC, SPHERE_BOX, SPHERE_SPHERE };  // which event is dispatched
+
+        GameObject *gameObject1 = nullptr;
+        GameObject *gameObject2 = nullptr;
+        Type type = GENERIC;
+        glm::vec3 closestPoint = glm::vec3(0);  // SPHERE_BOX only
+        glm::vec3 displacement = glm::vec3(0);
+        float distance = 0;
+        float sumRadius = 0;                    // SPHERE_SPHERE only
+        float timeOfImpact = 1;                 // see CollisionEvent
+
+        // swaps the point of view, for the symmetric collision functions
+        void Flip() { displacement = -displacement; }
+        void Dispatch() const;
     };
 
-    // the following uses double dispatch with a double dispatch table and no C++ RTTI
-    // (typeid(expression) and dynamic_cast<type>(expression)). It uses typeid(type);
+    // the following uses double dispatch with a dense double dispatch table and no C++
+    // RTTI. Every hitarea type gets a small integer id the first time it is asked for,
+    // which indexes the table directly.
     // The visitor pattern was not suitable here because I don't want the hierarchy to
     // be closed, that is, the base class has to know about all the derived classes,
     // which is not extensible. 
 
-    // a hit area has a support gameobject and determines collisions
+    // a hit area belongs to a gameobject and determines collisions
     // note that the hitarea does not contain the shape, as it carries no information
-    // instead, concrete hitareas contain concrete shapes
+    // instead, concrete hitareas contain concrete shapes.
+    // The hitarea has its own transform relative to its gameobject, and keeps its world
+    // center and extents, which are recalculated along with the world transform of the
+    // gameobject. The collision code only reads those
     struct HitArea {
-        HitArea(GameObject *support) : support(support) {}
+        HitArea(GameObject *owner, int shapeId) : owner(owner), shapeId(shapeId) {}
         virtual ~HitArea() = default;
 
-        GameObject *support;
+        // every cannonball makes one, so they come from a slab allocator
+        static void *operator new(size_t size) { return allocator.Allocate(size); }
+        static void operator delete(void *block, size_t size) { allocator.Free(block, size); }
+        static const SlabAllocator::Stats &GetAllocatorStats() { return allocator.GetStats(); }
+
+        GameObject *owner;
+        const int shapeId;
+
+        // relative to the gameobject
+        glm::vec3 offset = glm::vec3(0);
+        glm::vec3 scale = glm::vec3(1);
+        glm::quat rotation = glm::quat(1, 0, 0, 0);
+
+        // in world space, as of the last time the gameobject's transform was calculated
+        glm::vec3 center = glm::vec3(0);
+        glm::vec3 halfExtents = glm::vec3(0);  // half the size of the bounds on each axis
+
+        // recalculates center and halfExtents from the world transform of the gameobject
+        void Refit(glm::vec3 ownerPosition, glm::quat ownerRotation, glm::vec3 ownerScale)
+        {
+            center = ownerPosition + ownerRotation * (ownerScale * offset);
+            halfExtents = GetHalfExtents(scale * ownerScale);
+        }
 
+        // point is in the space of the hitarea, see GameObject::Contains
         virtual bool Contains(glm::vec3 point) = 0;
-        bool Collides(HitArea *other, CollisionEventPtr &event, CollisionEventPtr &otherEvent);
+        // world space bounds of the hit area, used by the broadphase
+        AABB GetBounds() const { return AABB(center - halfExtents, center + halfExtents); }
+
+        // for the scene queries, all in world space:
+        // a sphere moving from start to end against the hitarea, see SweepSphereBox
+        virtual bool SweepSphere(glm::vec3 start, glm::vec3 end, float radius, float &toi) = 0;
+        virtual bool OverlapsBox(glm::vec3 center, glm::vec3 halfSize) = 0;
+        // the outward normal of the surface where it is closest to point
+        virtual glm::vec3 GetNormal(glm::vec3 point) = 0;
+        // halfExtents, for the given world scale of the hitarea
+        virtual glm::vec3 GetHalfExtents(glm::vec3 worldScale) = 0;
+        bool Collides(HitArea *other, Contact &contact)
+        {
+            CollidesFunc collisionFunc = collisionFuncs[shapeId][other->shapeId];
+            return collisionFunc != nullptr && collisionFunc(this, other, contact);
+        }
+
+        // the id of a hitarea type, assigned the first time it is asked for
+        template <typename T>
+        static int ShapeId()
+        {
+            static const int id = NewShapeId();
+            return id;
+        }
 
     protected:
-        typedef bool (*CollidesFunc)(HitArea *, HitArea *, CollisionEventPtr &, CollisionEventPtr &);
-        virtual std::type_index GetType() = 0;
-        typedef std::pair<std::type_index, std::type_index> type_pair;
-        struct pair_hash {
-            std::size_t operator() (const type_pair &pair) const {
-                return pair.first.hash_code() ^ pair.second.hash_code();
-            }
-        };
-        static std::unordered_map<type_pair, CollidesFunc, pair_hash> collisionFuncs;
+        typedef bool (*CollidesFunc)(HitArea *, HitArea *, Contact &);
+        static CollidesFunc collisionFuncs[MAX_SHAPE_TYPES][MAX_SHAPE_TYPES];
+        static SlabAllocator allocator;
+        static int NewShapeId();
+
         // this is called by the derived classes to register their collision functions;
         // when extending the engine with new hitareas, this function must be called
-        // for each new pair of hitareas that can collide. The func parameter must be
-        // cast to CollidesFunc, even though this cast is unsafe in general. The user
-        // must ensure that the passed function takes two HitArea pointers of the types
-        // specified by the type_index parameters.
-        static void RegisterCollisionFunc(std::type_index type1, std::type_index type2, 
-                                          CollidesFunc func);
+        // for each new pair of hitareas that can collide. It generates the type-safe
+        // thunk for (A, B) and its symmetric counterpart for (B, A), which calls func
+        // with the arguments swapped and flips the contact.
+        template <typename A, typename B, bool (*func)(A *, B *, Contact &)>
+        static void RegisterCollisionFunc()
+        {
+            collisionFuncs[ShapeId<A>()][ShapeId<B>()] = [](HitArea *a, HitArea *b, Contact &contact) {
+                return func(static_cast<A *>(a), static_cast<B *>(b), contact);
+            };
+            if (ShapeId<A>() == ShapeId<B>())
+                return;
+            collisionFuncs[ShapeId<B>()][ShapeId<A>()] = [](HitArea *b, HitArea *a, Contact &contact) {
+                bool collided = func(static_cast<A *>(a), static_cast<B *>(b), contact);
+                contact.Flip();
+                return collided;
+            };
+        }
     };
 
     struct BoxShape : public Shape {
         BoxShape() = default;
         BoxShape(float width, float height, float depth) 
             : width(width), height(height), depth(depth) {};
-        HitArea *CreateHitArea(GameObject *support) override;
+        HitArea *CreateHitArea(GameObject *owner) override;
 
         float width, height, depth;
     };
 
     struct BoxHitArea : public HitArea
     {
-        BoxHitArea(GameObject *support, BoxShape shape) 
-            : HitArea(support), shape(shape) {}
+        BoxHitArea(GameObject *owner, BoxShape shape) 
+            : HitArea(owner, ShapeId<BoxHitArea>()), shape(shape) {}
         BoxShape shape;
         bool Contains(glm::vec3 point) override;
-
-    protected:
-        std::type_index GetType() override { return typeid(BoxHitArea); }
+        bool SweepSphere(glm::vec3 start, glm::vec3 end, float radius, float &toi) override;
+        bool OverlapsBox(glm::vec3 center, glm::vec3 halfSize) override;
+        glm::vec3 GetNormal(glm::vec3 point) override;
+        glm::vec3 GetHalfExtents(glm::vec3 worldScale) override;
+        // half of the world size of the box, on each axis
+        glm::vec3 GetHalfSize() const { return halfExtents; }
 
     private:
         static const struct init { init(); } initializer;
     };
 
-    bool CollidesBoxBox(BoxHitArea *, BoxHitArea *, CollisionEventPtr &, CollisionEventPtr &);
-    bool CollidesBoxSphere(BoxHitArea *, SphereHitArea *, CollisionEventPtr &, CollisionEventPtr &);
-    bool CollidesSphereBox(SphereHitArea *, BoxHitArea *, CollisionEventPtr &, CollisionEventPtr &);
+    bool CollidesBoxBox(BoxHitArea *, BoxHitArea *, Contact &);
+    bool CollidesBoxSphere(BoxHitArea *, SphereHitArea *, Contact &);
+
+    // the batched narrowphase kernels compute exactly this, lane by lane
+    inline glm::vec3 ClosestPointOnBox(glm::vec3 point, glm::vec3 boxCenter, glm::vec3 halfSize)
+    {
+        return glm::min(glm::max(point, boxCenter - halfSize), boxCenter + halfSize);
+    }
+
+    // swept tests, for continuous collision: the sphere moves in a straight line from
+    // start to end while the other shape stays still. toi is the fraction of the way
+    // at which they first touch, 0 if they already touch at the start
+    bool SweepSphereBox(glm::vec3 start, glm::vec3 end, float radius,
+                        glm::vec3 boxCenter, glm::vec3 halfSize, float &toi);
+    bool SweepSphereSphere(glm::vec3 start, glm::vec3 end, float radius,
+                           glm::vec3 center, float otherRadius, float &toi);
 
     struct SphereShape : public Shape {
         SphereShape() = default;
         SphereShape(float radius) : radius(radius) {};
-        HitArea *CreateHitArea(GameObject *support) override;
+        HitArea *CreateHitArea(GameObject *owner) override;
         float radius;
     };
 
     struct SphereHitArea : public HitArea
     {
-        SphereHitArea(GameObject *support, SphereShape shape) 
-            : HitArea(support), shape(shape) {}
+        SphereHitArea(GameObject *owner, SphereShape shape) 
+            : HitArea(owner, ShapeId<SphereHitArea>()), shape(shape) {}
         SphereShape shape;
         bool Contains(glm::vec3 point) override;
-
-    protected:
-        std::type_index GetType() override { return typeid(SphereHitArea); }
+        bool SweepSphere(glm::vec3 start, glm::vec3 end, float radius, float &toi) override;
+        bool OverlapsBox(glm::vec3 center, glm::vec3 halfSize) override;
+        glm::vec3 GetNormal(glm::vec3 point) override;
+        glm::vec3 GetHalfExtents(glm::vec3 worldScale) override;
+        float GetRadius() const { return halfExtents.x; }  // world radius
 
     private:
         static const struct init { init(); } initializer;
     };
 
-    bool CollidesSphereSphere(SphereHitArea *, SphereHitArea *, CollisionEventPtr &, CollisionEventPtr &);
+    bool CollidesSphereSphere(SphereHitArea *, SphereHitArea *, Contact &);
 
     class CollisionEvent
     {
-        friend class ControlledScene3D;  // only the scene can dispatch collision events
+        friend struct Contact;  // only contacts, and so only the scene, can dispatch collision events
     public:
         CollisionEvent(GameObject *gameObject): gameObject(gameObject) {}
         virtual ~CollisionEvent() = default;
         GameObject *gameObject;
+        // when the contact was found by a swept test, the fraction of this frame's motion
+        // at which the objects first touched; 1 for the usual, discrete, contacts
+        float timeOfImpact = 1;
     private:
         virtual void Dispatch(GameObject *target);
     };
@@ -1,106 +1,200 @@
 #include <iostream>
+#include <unordered_map>
 
-#include "core/managers/texture_manager.h"
 #include "material.h"
 
 using namespace engine;
 
-Material::Material(Shader *shader): shader(shader) 
+// what each shader program was last given, see Material::Use
+struct ProgramBinding
+{
+    uint64_t templateStamp = 0;
+    uint64_t overridesStamp = 0;
+};
+
+static std::unordered_map<GLuint, ProgramBinding> programBindings;
+static Texture2D *boundTexture = nullptr;
+static int boundWireframe = -1;  // -1 until a material sets the polygon mode
+static uint64_t lastStamp = 0;
+
+static uint64_t NewStamp()
+{
+    return ++lastStamp;
+}
+
+// the type of vertex input a parameter of the given type fills exactly
+static GLenum InputType(MaterialParameter::Type type)
+{
+    switch (type) {
+    case MaterialParameter::INT: return GL_INT;
+    case MaterialParameter::FLOAT: return GL_FLOAT;
+    case MaterialParameter::VEC2: return GL_FLOAT_VEC2;
+    case MaterialParameter::VEC3: return GL_FLOAT_VEC3;
+    case MaterialParameter::MAT3: return GL_FLOAT_MAT3;
+    default: return GL_FLOAT_MAT4;
+    }
+}
+
+void MaterialParameter::Upload() const
+{
+    if (type == INT) {
+        glUniform1i(location, value.intValue);
+    } else if (type == FLOAT) {
+        glUniform1f(location, value.floatValue);
+    } else if (type == VEC2) {
+        glUniform2fv(location, 1, glm::value_ptr(value.vec2Value));
+    } else if (type == VEC3) {
+        glUniform3fv(location, 1, glm::value_ptr(value.vec3Value));
+    } else if (type == MAT3) {
+        glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value.mat3Value));
+    } else if (type == MAT4) {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value.mat4Value));
+    }
+}
+
+MaterialTemplate::MaterialTemplate(Shader *shader): shader(shader), stamp(NewStamp())
 {
     if (!shader || !shader->program)
         return;
-    shader->Use();
     // gfxc framework already binds the sampler2D textures, but I don't like the uniform names
     for (int i = 0; i < 16; i++) {
-        std::string name = "WIST_TEXTURE_" + std::to_string(i);
-        GLint loc_texture = glGetUniformLocation(shader->program, name.c_str());
-        if (loc_texture >= 0)
-            glUniform1i(loc_texture, i);
+        GLint location = shader->GetUniformLocation("WIST_TEXTURE_" + std::to_string(i));
+        if (location < 0)
+            continue;
+        MaterialParameter sampler;
+        sampler.location = location;
+        sampler.type = MaterialParameter::INT;
+        sampler.value.intValue = i;
+        parameters.push_back(sampler);
+    }
+}
+
+Material::Material(const MaterialTemplate *base): shader(base->shader), base(base) {}
+
+void Material::Set(const std::string &name, MaterialParameter::Type type, const MaterialParameter::Value &value)
+{
+    if (!shader || !shader->program)
+        return;
+    // parameters the shader doesn't use have no location, there's nothing to upload then
+    std::vector<MaterialParameter> *parameters = &overrides;
+    GLint location = shader->GetUniformLocation(name);
+    if (location >= 0) {
+        stamp = NewStamp();
+    } else {
+        const Shader::Attribute *attribute = shader->GetAttribute(name);
+        if (attribute == nullptr || attribute->location < WIST_FIRST_INSTANCE_LOCATION)
+            return;
+        // the render queue copies the value as the input's type, so anything else would
+        // send it bytes that were never set, or a float's bits as an int
+        if (attribute->type != InputType(type)) {
+            std::cerr << "Material parameter " << name << " doesn't match the type of the shader input.\n";
+            exit(1);
+        }
+        location = attribute->location;
+        parameters = &instanceParameters;
+    }
+
+    for (auto &parameter : *parameters) {
+        if (parameter.location == location) {
+            parameter.type = type;
+            parameter.value = value;
+            return;
+        }
     }
+    parameters->push_back({location, type, value});
 }
 
-Material::~Material() {}
+void Material::SetInt(const std::string &name, int value)
+{
+    MaterialParameter::Value parameterValue;
+    parameterValue.intValue = value;
+    Set(name, MaterialParameter::INT, parameterValue);
+}
 
-void Material::SetInt(std::string name, int value)
+void Material::SetFloat(const std::string &name, float value)
 {
-    UniformValue uniformValue;
-    uniformValue.intValue = value;
-    uniforms[name] = std::make_pair(INT, uniformValue);
+    MaterialParameter::Value parameterValue;
+    parameterValue.floatValue = value;
+    Set(name, MaterialParameter::FLOAT, parameterValue);
 }
 
-void Material::SetFloat(std::string name, float value)
+void Material::SetVec2(const std::string &name, glm::vec2 value)
 {
-    UniformValue uniformValue;
-    uniformValue.floatValue = value;
-    uniforms[name] = std::make_pair(FLOAT, uniformValue);
+    MaterialParameter::Value parameterValue;
+    parameterValue.vec2Value = value;
+    Set(name, MaterialParameter::VEC2, parameterValue);
 }
 
-void Material::SetVec2(std::string name, glm::vec2 value)
+void Material::SetVec3(const std::string &name, glm::vec3 value)
 {
-    UniformValue uniformValue;
-    uniformValue.vec2Value = value;
-    uniforms[name] = std::make_pair(VEC2, uniformValue);
+    MaterialParameter::Value parameterValue;
+    parameterValue.vec3Value = value;
+    Set(name, MaterialParameter::VEC3, parameterValue);
 }
 
-void Material::SetVec3(std::string name, glm::vec3 value)
+void Material::SetMat3(const std::string &name, glm::mat3 value)
 {
-    UniformValue uniformValue;
-    uniformValue.vec3Value = value;
-    uniforms[name] = std::make_pair(VEC3, uniformValue);
+    MaterialParameter::Value parameterValue;
+    parameterValue.mat3Value = value;
+    Set(name, MaterialParameter::MAT3, parameterValue);
 }
 
-void Material::SetMat3(std::string name, glm::mat3 value)
+void Material::SetMat4(const std::string &name, glm::mat4 value)
 {
-    UniformValue uniformValue;
-    uniformValue.mat3Value = value;
-    uniforms[name] = std::make_pair(MAT3, uniformValue);
+    MaterialParameter::Value parameterValue;
+    parameterValue.mat4Value = value;
+    Set(name, MaterialParameter::MAT4, parameterValue);
 }
 
-void Material::SetMat4(std::string name, glm::mat4 value)
+void Material::Use() const
 {
-    UniformValue uniformValue;
-    uniformValue.mat4Value = value;
-    uniforms[name] = std::make_pair(MAT4, uniformValue);
+    if (!base || !shader || !shader->program)
+        return;
+    shader->Use();
+    Apply();
 }
 
-void Material::Use()
+void Material::Apply() const
 {
-    if (!shader || !shader->program)
+    if (!base || !shader || !shader->program)
         return;
 
-    if (wireframe) {
-        glLineWidth(1);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    } else {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    if ((int)wireframe != boundWireframe) {
+        if (wireframe) {
+            glLineWidth(1);
+            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        } else {
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        }
+        boundWireframe = wireframe;
     }
 
-    shader->Use();
-
-    if (texture) {
+    if (texture && texture != boundTexture) {
         texture->BindToTextureUnit(GL_TEXTURE0);
-        GLuint loc_texture = glGetUniformLocation(shader->program, "WIST_TEXTURE_0");
-        glUniform1i(loc_texture, 0);
+        boundTexture = texture;
     }
 
-    for (auto [name, uniform] : uniforms) {
-        auto [type, value] = uniform;
-        GLint location = glGetUniformLocation(shader->program, name.c_str());
-        if (type == INT) {
-            glUniform1i(location, value.intValue);
-        } else if (type == FLOAT) {
-            glUniform1f(location, value.floatValue);
-        } else if (type == VEC2) {
-            glUniform2fv(location, 1, glm::value_ptr(value.vec2Value));
-        } else if (type == VEC3) {
-            glUniform3fv(location, 1, glm::value_ptr(value.vec3Value));
-        } else if (type == MAT3) {
-            glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value.mat3Value));
-        } else if (type == MAT4) {
-            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value.mat4Value));
-        }
+    // the program keeps its uniforms, so only what differs from last time is uploaded.
+    // The template only holds the samplers; they go again whenever the previous material
+    // had overrides, in case one of those was a sampler. A uniform the previous material
+    // overrode and this one doesn't set keeps the previous value, so materials of the
+    // same template should all set the same uniforms
+    ProgramBinding &binding = programBindings[shader->program];
+    if (binding.templateStamp == base->GetStamp() && binding.overridesStamp == stamp)
+        return;
+    if (binding.templateStamp != base->GetStamp() || binding.overridesStamp != 0) {
+        for (auto &parameter : base->GetParameters())
+            parameter.Upload();
+        binding.templateStamp = base->GetStamp();
     }
+    for (auto &parameter : overrides)
+        parameter.Upload();
+    binding.overridesStamp = stamp;
 }
 
-
-
+void Material::ForgetBindings()
+{
+    programBindings.clear();
+    boundTexture = nullptr;
+    boundWireframe = -1;
+}
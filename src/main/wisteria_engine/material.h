@@ -1,45 +1,105 @@
 #pragma once
+#include <cstdint>
+#include <vector>
 
 #include "core/gpu/shader.h"
 #include "core/gpu/texture2D.h"
 #include "utils/glm_utils.h"
 
+// meshes use the vertex inputs up to 3; the ones from here on are per instance (the model
+// matrix, instanced material parameters), see RenderQueue
+#define WIST_FIRST_INSTANCE_LOCATION 4
+
 namespace engine
 {
-    class Material
+    // a uniform or per instance value, with the location it goes to looked up once, when
+    // it was set
+    struct MaterialParameter
     {
-    public:
-        Material(): shader(nullptr) {}
-        Material(Shader *shader);
-        ~Material();
-
-        void SetInt(std::string name, int value);
-        void SetFloat(std::string name, float value);
-        void SetVec2(std::string name, glm::vec2 value);
-        void SetVec3(std::string name, glm::vec3 value);
-        void SetMat3(std::string name, glm::mat3 value);
-        void SetMat4(std::string name, glm::mat4 value);
-
-        void Use();
-
-        Shader *shader;
-        Texture2D *texture = nullptr;
-        bool wireframe = false; 
-
-    private:
-        enum UniformType
+        enum Type
         {
             INT, FLOAT,
             VEC2, VEC3,
             MAT3, MAT4
         };
-        union UniformValue
+        union Value
         {
             int intValue;
             float floatValue;
             glm::vec2 vec2Value; glm::vec3 vec3Value;
             glm::mat3 mat3Value; glm::mat4 mat4Value;
         };
-        std::unordered_map<std::string, std::pair<UniformType, UniformValue>> uniforms;
+
+        GLint location;
+        Type type;
+        Value value;
+
+        void Upload() const;
+    };
+
+    // The part of a material that every gameobject using it shares: the shader and the
+    // parameters that don't change per gameobject (the samplers, for now). Made once by
+    // Assets::CreateMaterial and never changed after, so materials only point to it
+    class MaterialTemplate
+    {
+    public:
+        MaterialTemplate(Shader *shader);
+
+        Shader *const shader;
+        const std::vector<MaterialParameter> &GetParameters() const { return parameters; }
+        uint64_t GetStamp() const { return stamp; }
+
+    private:
+        std::vector<MaterialParameter> parameters;
+        uint64_t stamp;
+    };
+
+    // A template plus what one gameobject changes in it (tank hp and hues, uv transform of
+    // buildings...). Copying one is cheap, it's a pointer and the few overridden values.
+    // Use remembers what each shader program was last given, so drawing with the same
+    // material, or one with the same values, doesn't upload anything again.
+    // A parameter the shader declares as a per instance vertex input instead of a uniform
+    // isn't uploaded at all; the render queue puts it in the instance buffer, so materials
+    // that only differ in those can be drawn together. Those have to be set with the
+    // input's exact type (SetInt for an int, SetMat3 for a mat3...)
+    class Material
+    {
+    public:
+        Material(): shader(nullptr) {}
+        Material(const MaterialTemplate *base);
+        ~Material() = default;
+
+        void SetInt(const std::string &name, int value);
+        void SetFloat(const std::string &name, float value);
+        void SetVec2(const std::string &name, glm::vec2 value);
+        void SetVec3(const std::string &name, glm::vec3 value);
+        void SetMat3(const std::string &name, glm::mat3 value);
+        void SetMat4(const std::string &name, glm::mat4 value);
+
+        void Use() const;
+        // Use without binding the shader, for when it's the program in use already
+        void Apply() const;
+        // forget what was uploaded, in case the GL state was changed behind the materials'
+        // back; the scene does it every frame
+        static void ForgetBindings();
+
+        const MaterialTemplate *GetTemplate() const { return base; }
+        // materials with the same template and stamp have the same uniforms
+        uint64_t GetStamp() const { return stamp; }
+        const std::vector<MaterialParameter> &GetInstanceParameters() const { return instanceParameters; }
+
+        Shader *shader;
+        Texture2D *texture = nullptr;
+        bool wireframe = false;
+
+    private:
+        void Set(const std::string &name, MaterialParameter::Type type, const MaterialParameter::Value &value);
+
+        const MaterialTemplate *base = nullptr;
+        std::vector<MaterialParameter> overrides;
+        std::vector<MaterialParameter> instanceParameters;
+        // new every time the uniform overrides change, 0 while there are none. Copies
+        // keep it, since they hold the same values
+        uint64_t stamp = 0;
     };
-}
\ No newline at end of file
+}
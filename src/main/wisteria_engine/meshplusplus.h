@@ -77,6 +77,7 @@ namespace engine
                 const aiMesh* paiMesh = pScene->mMeshes[i];
                 InitMesh(paiMesh);
             }
+            ComputeBounds();
 
             if (useMaterial && !InitMaterials(pScene))
                 return false;
@@ -0,0 +1,379 @@
+#include "narrowphase3d.h"
+#include "gameobject3d.h"
+#include <algorithm>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define WIST_X86_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// lets GCC and Clang compile a single function for a newer instruction set than the
+// rest of the program; MSVC doesn't need it
+#if defined(__GNUC__) || defined(__clang__)
+#define WIST_TARGET(isa) __attribute__((target(isa)))
+#else
+#define WIST_TARGET(isa)
+#endif
+
+// below this, waking up another thread costs more than the pair tests it would take over
+#define NARROWPHASE_MIN_PAIRS_PER_THREAD 128
+
+using namespace engine;
+
+struct SphereBoxArrays {
+    const float *sphereX, *sphereY, *sphereZ;
+    const float *boxX, *boxY, *boxZ, *halfX, *halfY, *halfZ;
+    float *closestX, *closestY, *closestZ, *distance;
+};
+
+// a kernel tests the pairs in [begin, end) and returns where it stopped;
+// the vector kernels leave the last few pairs to the scalar one
+typedef size_t (*SphereBoxKernel)(const SphereBoxArrays &, size_t begin, size_t end);
+
+static size_t SphereBoxScalar(const SphereBoxArrays &a, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i) {
+        glm::vec3 sphereCenter = glm::vec3(a.sphereX[i], a.sphereY[i], a.sphereZ[i]);
+        glm::vec3 closestPoint = ClosestPointOnBox(sphereCenter,
+                                                   glm::vec3(a.boxX[i], a.boxY[i], a.boxZ[i]),
+                                                   glm::vec3(a.halfX[i], a.halfY[i], a.halfZ[i]));
+        a.closestX[i] = closestPoint.x;
+        a.closestY[i] = closestPoint.y;
+        a.closestZ[i] = closestPoint.z;
+        a.distance[i] = glm::length(sphereCenter - closestPoint);
+    }
+    return end;
+}
+
+#ifdef WIST_X86_SIMD
+// both kernels do the operations in the same order as the scalar code, so the results
+// are the same up to the last bit
+WIST_TARGET("sse2")
+static size_t SphereBoxSSE(const SphereBoxArrays &a, size_t begin, size_t end)
+{
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 sphereX = _mm_loadu_ps(a.sphereX + i);
+        __m128 sphereY = _mm_loadu_ps(a.sphereY + i);
+        __m128 sphereZ = _mm_loadu_ps(a.sphereZ + i);
+        __m128 boxX = _mm_loadu_ps(a.boxX + i);
+        __m128 boxY = _mm_loadu_ps(a.boxY + i);
+        __m128 boxZ = _mm_loadu_ps(a.boxZ + i);
+        __m128 halfX = _mm_loadu_ps(a.halfX + i);
+        __m128 halfY = _mm_loadu_ps(a.halfY + i);
+        __m128 halfZ = _mm_loadu_ps(a.halfZ + i);
+
+        __m128 closestX = _mm_min_ps(_mm_max_ps(sphereX, _mm_sub_ps(boxX, halfX)), _mm_add_ps(boxX, halfX));
+        __m128 closestY = _mm_min_ps(_mm_max_ps(sphereY, _mm_sub_ps(boxY, halfY)), _mm_add_ps(boxY, halfY));
+        __m128 closestZ = _mm_min_ps(_mm_max_ps(sphereZ, _mm_sub_ps(boxZ, halfZ)), _mm_add_ps(boxZ, halfZ));
+
+        __m128 dx = _mm_sub_ps(sphereX, closestX);
+        __m128 dy = _mm_sub_ps(sphereY, closestY);
+        __m128 dz = _mm_sub_ps(sphereZ, closestZ);
+        __m128 squaredDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                                            _mm_mul_ps(dz, dz));
+
+        _mm_storeu_ps(a.closestX + i, closestX);
+        _mm_storeu_ps(a.closestY + i, closestY);
+        _mm_storeu_ps(a.closestZ + i, closestZ);
+        _mm_storeu_ps(a.distance + i, _mm_sqrt_ps(squaredDistance));
+    }
+    return i;
+}
+
+WIST_TARGET("avx")
+static size_t SphereBoxAVX(const SphereBoxArrays &a, size_t begin, size_t end)
+{
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 sphereX = _mm256_loadu_ps(a.sphereX + i);
+        __m256 sphereY = _mm256_loadu_ps(a.sphereY + i);
+        __m256 sphereZ = _mm256_loadu_ps(a.sphereZ + i);
+        __m256 boxX = _mm256_loadu_ps(a.boxX + i);
+        __m256 boxY = _mm256_loadu_ps(a.boxY + i);
+        __m256 boxZ = _mm256_loadu_ps(a.boxZ + i);
+        __m256 halfX = _mm256_loadu_ps(a.halfX + i);
+        __m256 halfY = _mm256_loadu_ps(a.halfY + i);
+        __m256 halfZ = _mm256_loadu_ps(a.halfZ + i);
+
+        __m256 closestX = _mm256_min_ps(_mm256_max_ps(sphereX, _mm256_sub_ps(boxX, halfX)), _mm256_add_ps(boxX, halfX));
+        __m256 closestY = _mm256_min_ps(_mm256_max_ps(sphereY, _mm256_sub_ps(boxY, halfY)), _mm256_add_ps(boxY, halfY));
+        __m256 closestZ = _mm256_min_ps(_mm256_max_ps(sphereZ, _mm256_sub_ps(boxZ, halfZ)), _mm256_add_ps(boxZ, halfZ));
+
+        __m256 dx = _mm256_sub_ps(sphereX, closestX);
+        __m256 dy = _mm256_sub_ps(sphereY, closestY);
+        __m256 dz = _mm256_sub_ps(sphereZ, closestZ);
+        __m256 squaredDistance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                               _mm256_mul_ps(dz, dz));
+
+        _mm256_storeu_ps(a.closestX + i, closestX);
+        _mm256_storeu_ps(a.closestY + i, closestY);
+        _mm256_storeu_ps(a.closestZ + i, closestZ);
+        _mm256_storeu_ps(a.distance + i, _mm256_sqrt_ps(squaredDistance));
+    }
+    return i;
+}
+
+static bool CpuHasSSE2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool CpuHasAVX()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    // the OS must also save the upper halves of the registers on context switches
+    return avx && osxsave && (_xgetbv(0) & 0x6) == 0x6;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx");
+#endif
+}
+#endif
+
+struct SphereBoxKernelChoice {
+    SphereBoxKernel kernel;
+    const char *name;
+};
+
+static const SphereBoxKernelChoice &GetSphereBoxKernel()
+{
+    static const SphereBoxKernelChoice choice = []() -> SphereBoxKernelChoice {
+#ifdef WIST_X86_SIMD
+        if (CpuHasAVX())
+            return {SphereBoxAVX, "avx"};
+        if (CpuHasSSE2())
+            return {SphereBoxSSE, "sse"};
+#endif
+        return {SphereBoxScalar, "scalar"};
+    }();
+    return choice;
+}
+
+const char *SphereBoxBatch::KernelName()
+{
+    return GetSphereBoxKernel().name;
+}
+
+void SphereBoxBatch::Clear()
+{
+    pairs.clear();
+    sphereX.clear(); sphereY.clear(); sphereZ.clear(); radius.clear();
+    boxX.clear(); boxY.clear(); boxZ.clear();
+    halfX.clear(); halfY.clear(); halfZ.clear();
+}
+
+void SphereBoxBatch::Add(GameObject *gameObject1, GameObject *gameObject2,
+                         BoxHitArea *box, SphereHitArea *sphere, bool sphereFirst)
+{
+    glm::vec3 sphereCenter = sphere->center;
+    glm::vec3 boxCenter = box->center;
+    glm::vec3 halfSize = box->GetHalfSize();
+
+    pairs.push_back({gameObject1, gameObject2, sphereFirst});
+    sphereX.push_back(sphereCenter.x);
+    sphereY.push_back(sphereCenter.y);
+    sphereZ.push_back(sphereCenter.z);
+    radius.push_back(sphere->GetRadius());
+    boxX.push_back(boxCenter.x);
+    boxY.push_back(boxCenter.y);
+    boxZ.push_back(boxCenter.z);
+    halfX.push_back(halfSize.x);
+    halfY.push_back(halfSize.y);
+    halfZ.push_back(halfSize.z);
+}
+
+void SphereBoxBatch::Run(std::vector<Contact> &contacts)
+{
+    size_t count = pairs.size();
+    closestX.resize(count);
+    closestY.resize(count);
+    closestZ.resize(count);
+    distance.resize(count);
+
+    SphereBoxArrays arrays = {
+        sphereX.data(), sphereY.data(), sphereZ.data(),
+        boxX.data(), boxY.data(), boxZ.data(), halfX.data(), halfY.data(), halfZ.data(),
+        closestX.data(), closestY.data(), closestZ.data(), distance.data()
+    };
+    size_t done = GetSphereBoxKernel().kernel(arrays, 0, count);
+    SphereBoxScalar(arrays, done, count);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!(distance[i] <= radius[i]))
+            continue;
+
+        // the kernels see the pair from the box, like CollidesBoxSphere
+        Contact contact;
+        contact.gameObject1 = pairs[i].gameObject1;
+        contact.gameObject2 = pairs[i].gameObject2;
+        contact.type = Contact::SPHERE_BOX;
+        contact.closestPoint = glm::vec3(closestX[i], closestY[i], closestZ[i]);
+        contact.displacement = glm::vec3(sphereX[i], sphereY[i], sphereZ[i]) - contact.closestPoint;
+        contact.distance = distance[i];
+        if (pairs[i].sphereFirst)
+            contact.Flip();
+        contacts.push_back(contact);
+    }
+}
+
+Narrowphase::Narrowphase()
+{
+    boxShapeId = HitArea::ShapeId<BoxHitArea>();
+    sphereShapeId = HitArea::ShapeId<SphereHitArea>();
+}
+
+bool Narrowphase::IsSwept(GameObject *gameObject)
+{
+    return gameObject->continuousCollision && gameObject->hitArea->shapeId == sphereShapeId &&
+           gameObject->sweepStart != gameObject->hitArea->center;
+}
+
+// Both objects are taken to move in a straight line during the frame. The tests are done
+// in the frame of the second one: the sphere moves relative to it, from its start position
+// shifted by how much the other one moved, to its end position.
+// Pairs that already touched at the start of the frame get the usual discrete test, so
+// only new impacts get a time of impact.
+glm::vec3 Narrowphase::RelativeSweepStart(GameObject *sphereObject, GameObject *other)
+{
+    glm::vec3 otherCenter = other->hitArea->center;
+    glm::vec3 otherStart = other->bodyType == BODY_STATIC ? otherCenter : other->sweepStart;
+    return sphereObject->sweepStart + (otherCenter - otherStart);
+}
+
+bool Narrowphase::SweptCollides(GameObject *gameObject1, GameObject *gameObject2, Contact &contact)
+{
+    int shape1 = gameObject1->hitArea->shapeId;
+    int shape2 = gameObject2->hitArea->shapeId;
+    if (shape1 == sphereShapeId && shape2 == sphereShapeId)
+        return SweptSphereSphere(gameObject1, gameObject2, contact);
+    if (shape1 == boxShapeId && shape2 == sphereShapeId)
+        return SweptBoxSphere(gameObject1, gameObject2, contact);
+    if (shape1 == sphereShapeId && shape2 == boxShapeId) {
+        bool collided = SweptBoxSphere(gameObject2, gameObject1, contact);
+        std::swap(contact.gameObject1, contact.gameObject2);
+        contact.Flip();
+        return collided;
+    }
+    return gameObject1->Collides(gameObject2, contact);
+}
+
+bool Narrowphase::SweptSphereSphere(GameObject *gameObject1, GameObject *gameObject2, Contact &contact)
+{
+    SphereHitArea *sphere = static_cast<SphereHitArea *>(gameObject1->hitArea);
+    SphereHitArea *other = static_cast<SphereHitArea *>(gameObject2->hitArea);
+    glm::vec3 start = RelativeSweepStart(gameObject1, gameObject2);
+    glm::vec3 end = sphere->center;
+    glm::vec3 otherCenter = other->center;
+    float radius = sphere->GetRadius();
+    float otherRadius = other->GetRadius();
+
+    float toi;
+    if (!SweepSphereSphere(start, end, radius, otherCenter, otherRadius, toi))
+        return false;
+    if (toi == 0)
+        return gameObject1->Collides(gameObject2, contact);
+
+    contact.gameObject1 = gameObject1;
+    contact.gameObject2 = gameObject2;
+    contact.type = Contact::SPHERE_SPHERE;
+    contact.displacement = otherCenter - (start + (end - start) * toi);
+    contact.distance = glm::length(contact.displacement);
+    contact.sumRadius = radius + otherRadius;
+    contact.timeOfImpact = toi;
+    return true;
+}
+
+// like CollidesBoxSphere, the contact is seen from the box
+bool Narrowphase::SweptBoxSphere(GameObject *boxObject, GameObject *sphereObject, Contact &contact)
+{
+    BoxHitArea *box = static_cast<BoxHitArea *>(boxObject->hitArea);
+    SphereHitArea *sphere = static_cast<SphereHitArea *>(sphereObject->hitArea);
+    glm::vec3 start = RelativeSweepStart(sphereObject, boxObject);
+    glm::vec3 end = sphere->center;
+    glm::vec3 boxCenter = box->center;
+    glm::vec3 halfSize = box->GetHalfSize();
+
+    float toi;
+    if (!SweepSphereBox(start, end, sphere->GetRadius(), boxCenter, halfSize, toi))
+        return false;
+    if (toi == 0)
+        return boxObject->Collides(sphereObject, contact);
+
+    glm::vec3 center = start + (end - start) * toi;
+    contact.gameObject1 = boxObject;
+    contact.gameObject2 = sphereObject;
+    contact.type = Contact::SPHERE_BOX;
+    contact.closestPoint = ClosestPointOnBox(center, boxCenter, halfSize);
+    contact.displacement = center - contact.closestPoint;
+    contact.distance = glm::length(contact.displacement);
+    contact.timeOfImpact = toi;
+    return true;
+}
+
+void Narrowphase::Run(const std::pair<GameObject *, GameObject *> *pairs, size_t count,
+                      std::vector<Contact> &contacts)
+{
+    sphereBoxBatch.Clear();
+    for (size_t i = 0; i < count; ++i) {
+        auto [gameObject1, gameObject2] = pairs[i];
+        HitArea *hitArea1 = gameObject1->hitArea;
+        HitArea *hitArea2 = gameObject2->hitArea;
+        if (IsSwept(gameObject1) || IsSwept(gameObject2)) {
+            Contact contact;
+            if (SweptCollides(gameObject1, gameObject2, contact))
+                contacts.push_back(contact);
+        } else if (hitArea1->shapeId == boxShapeId && hitArea2->shapeId == sphereShapeId) {
+            sphereBoxBatch.Add(gameObject1, gameObject2, static_cast<BoxHitArea *>(hitArea1),
+                               static_cast<SphereHitArea *>(hitArea2), false);
+        } else if (hitArea1->shapeId == sphereShapeId && hitArea2->shapeId == boxShapeId) {
+            sphereBoxBatch.Add(gameObject1, gameObject2, static_cast<BoxHitArea *>(hitArea2),
+                               static_cast<SphereHitArea *>(hitArea1), true);
+        } else {
+            Contact contact;
+            if (gameObject1->Collides(gameObject2, contact))
+                contacts.push_back(contact);
+        }
+    }
+    sphereBoxBatch.Run(contacts);
+}
+
+ParallelNarrowphase::ParallelNarrowphase(int threadCount) : workerPool(threadCount)
+{
+    narrowphases.resize(workerPool.GetThreadCount());
+    workerContacts.resize(workerPool.GetThreadCount());
+}
+
+void ParallelNarrowphase::Run(const std::vector<std::pair<GameObject *, GameObject *>> &pairs,
+                              std::vector<Contact> &contacts)
+{
+    for (auto &buffer : workerContacts)
+        buffer.clear();
+    workerPool.Run(pairs.size(), NARROWPHASE_MIN_PAIRS_PER_THREAD,
+        [&](int worker, size_t begin, size_t end) {
+            narrowphases[worker].Run(pairs.data() + begin, end - begin, workerContacts[worker]);
+        });
+
+    contacts.clear();
+    for (auto &buffer : workerContacts)
+        contacts.insert(contacts.end(), buffer.begin(), buffer.end());
+    std::sort(contacts.begin(), contacts.end(), [](const Contact &a, const Contact &b) {
+        uint32_t a1 = a.gameObject1->GetId(), b1 = b.gameObject1->GetId();
+        return a1 != b1 ? a1 < b1 : a.gameObject2->GetId() < b.gameObject2->GetId();
+    });
+}
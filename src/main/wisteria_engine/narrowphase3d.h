@@ -0,0 +1,81 @@
+#pragma once
+#include <vector>
+#include "hitarea3d.h"
+#include "workerpool.h"
+
+namespace engine
+{
+    class GameObject;
+
+    // Sphere vs box tests, batched. Sphere centers and radii and box centers and half
+    // sizes are gathered into structure-of-arrays buffers, then the closest point clamps
+    // and the distances are computed 8 (AVX) or 4 (SSE) pairs at a time. The kernel is
+    // picked once, at runtime, falling back to plain scalar code. All of them give
+    // the same contacts as CollidesBoxSphere.
+    class SphereBoxBatch
+    {
+    public:
+        void Clear();
+        void Add(GameObject *gameObject1, GameObject *gameObject2,
+                 BoxHitArea *box, SphereHitArea *sphere, bool sphereFirst);
+        // tests every pair added since the last Clear and appends the ones that
+        // collide to contacts, seen from gameObject1
+        void Run(std::vector<Contact> &contacts);
+
+        // "avx", "sse" or "scalar"
+        static const char *KernelName();
+
+    private:
+        struct Pair {
+            GameObject *gameObject1, *gameObject2;
+            bool sphereFirst;
+        };
+        std::vector<Pair> pairs;
+
+        std::vector<float> sphereX, sphereY, sphereZ, radius;
+        std::vector<float> boxX, boxY, boxZ, halfX, halfY, halfZ;
+        std::vector<float> closestX, closestY, closestZ, distance;
+    };
+
+    // runs the narrowphase over a list of candidate pairs: pairs with a continuous sphere
+    // collider get swept tests, the other sphere vs box pairs go through the batch and
+    // everything else through the hitarea collision table
+    class Narrowphase
+    {
+    public:
+        Narrowphase();
+        // tests count pairs; only reads the gameobjects, so several narrowphases can run
+        // on different pairs at the same time. The hitareas are read as they were last
+        // refit, so the transforms must be up to date, see GameObject::UpdateTransforms
+        void Run(const std::pair<GameObject *, GameObject *> *pairs, size_t count,
+                 std::vector<Contact> &contacts);
+
+    private:
+        bool IsSwept(GameObject *gameObject);
+        bool SweptCollides(GameObject *gameObject1, GameObject *gameObject2, Contact &contact);
+        bool SweptSphereSphere(GameObject *gameObject1, GameObject *gameObject2, Contact &contact);
+        bool SweptBoxSphere(GameObject *boxObject, GameObject *sphereObject, Contact &contact);
+        static glm::vec3 RelativeSweepStart(GameObject *sphereObject, GameObject *other);
+
+        int boxShapeId, sphereShapeId;
+        SphereBoxBatch sphereBoxBatch;
+    };
+
+    // Splits the pairs between the threads of a worker pool, each with its own narrowphase
+    // and contact buffer. The merged contacts are sorted by the ids of their gameobjects,
+    // so the order they are dispatched in, and so the game, is the same for any number
+    // of threads. A pair is only found once, so the key is unique
+    class ParallelNarrowphase
+    {
+    public:
+        explicit ParallelNarrowphase(int threadCount = 0);
+        void Run(const std::vector<std::pair<GameObject *, GameObject *>> &pairs,
+                 std::vector<Contact> &contacts);
+        int GetThreadCount() const { return workerPool.GetThreadCount(); }
+
+    private:
+        WorkerPool workerPool;
+        std::vector<Narrowphase> narrowphases;
+        std::vector<std::vector<Contact>> workerContacts;
+    };
+}
@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cstring>
+
+#include "renderqueue3d.h"
+
+using namespace engine;
+
+static uint64_t KeyBits(uint64_t value, int bits, int shift)
+{
+    return (value & ((1ull << bits) - 1)) << shift;
+}
+
+// how a vertex input of the given GL type is laid out; false for types the instance
+// buffer doesn't handle
+static bool InputShape(GLenum type, int &columns, int &components, bool &integer)
+{
+    columns = 1;
+    integer = false;
+    switch (type) {
+    case GL_FLOAT: components = 1; return true;
+    case GL_FLOAT_VEC2: components = 2; return true;
+    case GL_FLOAT_VEC3: components = 3; return true;
+    case GL_FLOAT_VEC4: components = 4; return true;
+    case GL_FLOAT_MAT2: columns = 2; components = 2; return true;
+    case GL_FLOAT_MAT3: columns = 3; components = 3; return true;
+    case GL_FLOAT_MAT4: columns = 4; components = 4; return true;
+    case GL_INT: integer = true; components = 1; return true;
+    case GL_INT_VEC2: integer = true; components = 2; return true;
+    case GL_INT_VEC3: integer = true; components = 3; return true;
+    case GL_INT_VEC4: integer = true; components = 4; return true;
+    default: return false;
+    }
+}
+
+RenderQueue::~RenderQueue()
+{
+    if (instanceBuffer != 0)
+        glDeleteBuffers(1, &instanceBuffer);
+}
+
+void RenderQueue::Add(int pass, Mesh *mesh, Shader *shader, const Material *material,
+                      const glm::mat4 &modelMatrix, float depth)
+{
+    // non negative floats sort the same as their bits
+    uint32_t depthBits;
+    depth = glm::max(depth, 0.0f);
+    std::memcpy(&depthBits, &depth, sizeof(depthBits));
+    if (pass == RENDER_PASS_TRANSPARENT)
+        depthBits = ~depthBits;
+
+    GLuint texture = material && material->texture ? material->texture->GetTextureID() : 0;
+    GLuint vao = mesh->GetBuffers()->m_VAO;
+    uint64_t key;
+    if (pass == RENDER_PASS_TRANSPARENT) {
+        // blending needs the order, so the depth goes first and the state only breaks ties
+        key = KeyBits(pass, 2, 62) |
+              KeyBits(depthBits, 32, 30) |
+              KeyBits(shader->program, 10, 20) |
+              KeyBits(texture, 10, 10) |
+              KeyBits(vao, 10, 0);
+    } else {
+        key = KeyBits(pass, 2, 62) |
+              KeyBits(shader->program, 10, 52) |
+              KeyBits(texture, 10, 42) |
+              KeyBits(vao, 10, 32) |
+              depthBits;
+    }
+
+    keys.push_back({key, (uint32_t)items.size()});
+    items.push_back({mesh, shader, material, modelMatrix});
+}
+
+const RenderQueue::InstanceLayout &RenderQueue::GetLayout(Shader *shader)
+{
+    auto found = layouts.find(shader->program);
+    if (found != layouts.end())
+        return found->second;
+
+    InstanceLayout &layout = layouts[shader->program];
+    const Shader::Attribute *model = shader->GetAttribute("WIST_MODEL_MATRIX");
+    if (model == nullptr || model->type != GL_FLOAT_MAT4 || model->location < WIST_FIRST_INSTANCE_LOCATION)
+        return layout;
+
+    layout.instanced = true;
+    layout.inputs.push_back({model->location, 4, 4, false, 0});
+    for (auto &attribute : shader->GetAttributes()) {
+        InstanceInput input;
+        input.location = attribute.second.location;
+        if (input.location < WIST_FIRST_INSTANCE_LOCATION || input.location == model->location)
+            continue;
+        if (InputShape(attribute.second.type, input.columns, input.components, input.integer))
+            layout.inputs.push_back(input);
+    }
+    // the model matrix stays first
+    std::sort(layout.inputs.begin() + 1, layout.inputs.end(),
+              [](const InstanceInput &a, const InstanceInput &b) { return a.location < b.location; });
+    for (auto &input : layout.inputs) {
+        input.offset = layout.stride;
+        layout.stride += input.columns * input.components * 4;
+    }
+    return layout;
+}
+
+bool RenderQueue::CanShareBatch(const Item &a, const Item &b) const
+{
+    if (a.mesh != b.mesh || a.shader != b.shader)
+        return false;
+    if (a.material == b.material)
+        return true;
+    if (a.material == nullptr || b.material == nullptr)
+        return false;
+    // everything but the per instance parameters has to match
+    return a.material->GetTemplate() == b.material->GetTemplate() &&
+           a.material->GetStamp() == b.material->GetStamp() &&
+           a.material->texture == b.material->texture &&
+           a.material->wireframe == b.material->wireframe;
+}
+
+void RenderQueue::WriteInstance(const Item &item, const InstanceLayout &layout)
+{
+    size_t start = instanceData.size();
+    instanceData.resize(start + layout.stride, 0);
+    uint8_t *instance = &instanceData[start];
+
+    std::memcpy(instance, glm::value_ptr(item.modelMatrix), sizeof(glm::mat4));
+    if (item.material == nullptr)
+        return;
+    // inputs the material doesn't set stay 0, like a uniform nobody set
+    for (size_t input = 1; input < layout.inputs.size(); ++input) {
+        const InstanceInput &instanceInput = layout.inputs[input];
+        for (auto &parameter : item.material->GetInstanceParameters()) {
+            if (parameter.location != instanceInput.location)
+                continue;
+            size_t size = std::min((size_t)instanceInput.columns * instanceInput.components * 4,
+                                   sizeof(parameter.value));
+            std::memcpy(instance + instanceInput.offset, &parameter.value, size);
+            break;
+        }
+    }
+}
+
+void RenderQueue::Submit(const glm::mat4 &viewProjection, Stats &stats)
+{
+    std::sort(keys.begin(), keys.end(),
+              [](const std::pair<uint64_t, uint32_t> &a, const std::pair<uint64_t, uint32_t> &b) {
+                  return a.first < b.first;
+              });
+
+    // neighbours that can be drawn together are, since the keys put them next to each other
+    batches.clear();
+    instanceData.clear();
+    for (uint32_t position = 0; position < keys.size(); ++position) {
+        const Item &item = items[keys[position].second];
+        const InstanceLayout &layout = GetLayout(item.shader);
+        if (layout.instanced && !batches.empty() &&
+            CanShareBatch(items[keys[position - 1].second], item)) {
+            ++batches.back().count;
+            WriteInstance(item, layout);
+            continue;
+        }
+        batches.push_back({position, 1, instanceData.size()});
+        if (layout.instanced)
+            WriteInstance(item, layout);
+    }
+
+    if (!instanceData.empty()) {
+        if (instanceBuffer == 0)
+            glGenBuffers(1, &instanceBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        // orphaned every time, so the driver hands over new memory instead of waiting for
+        // the draws of the last camera to be done with the old one
+        instanceBufferSize = std::max(instanceBufferSize, instanceData.size());
+        glBufferData(GL_ARRAY_BUFFER, instanceBufferSize, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instanceData.size(), instanceData.data());
+    }
+
+    GLuint program = 0;
+    const Material *material = nullptr;
+    GLuint vao = 0;
+    GLint locModelMatrix = INVALID_LOC, locMVP = INVALID_LOC;
+    for (auto &batch : batches) {
+        const Item &item = items[keys[batch.first].second];
+        const InstanceLayout &layout = GetLayout(item.shader);
+
+        if (item.shader->program != program) {
+            program = item.shader->program;
+            item.shader->Use();
+            locModelMatrix = item.shader->GetUniformLocation("WIST_MODEL_MATRIX");
+            locMVP = item.shader->GetUniformLocation("WIST_MVP");
+            material = nullptr;
+            ++stats.programBinds;
+        }
+        if (item.material != nullptr && item.material != material) {
+            material = item.material;
+            material->Apply();
+            ++stats.materialBinds;
+        }
+        GLuint itemVao = item.mesh->GetBuffers()->m_VAO;
+        if (itemVao != vao) {
+            vao = itemVao;
+            glBindVertexArray(vao);
+            ++stats.meshBinds;
+        }
+
+        // what Mesh::Render does, minus binding and unbinding the VAO every time
+        GLenum drawMode = item.mesh->GetDrawMode();
+        auto &entries = item.mesh->GetMeshEntries();
+        if (!layout.instanced) {
+            // the camera is in the WIST_CAMERA block already, only the model matrix changes
+            glUniformMatrix4fv(locModelMatrix, 1, GL_FALSE, glm::value_ptr(item.modelMatrix));
+            if (locMVP != INVALID_LOC) {
+                // only compute the MVP matrix if the shader uses it
+                glm::mat4 mvp = viewProjection * item.modelMatrix;
+                glUniformMatrix4fv(locMVP, 1, GL_FALSE, glm::value_ptr(mvp));
+            }
+            for (auto &entry : entries) {
+                glDrawElementsBaseVertex(drawMode, entry.nrIndices, GL_UNSIGNED_INT,
+                                         (void *)(sizeof(unsigned int) * entry.baseIndex), entry.baseVertex);
+                ++stats.draws;
+            }
+            ++stats.instances;
+            continue;
+        }
+
+        // the VAO keeps these, but the batch starts somewhere else in the buffer every time
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        for (auto &input : layout.inputs) {
+            for (int column = 0; column < input.columns; ++column) {
+                GLuint location = input.location + column;
+                const void *offset = (const void *)(batch.instanceOffset + input.offset +
+                                                    column * input.components * 4);
+                glEnableVertexAttribArray(location);
+                if (input.integer)
+                    glVertexAttribIPointer(location, input.components, GL_INT, layout.stride, offset);
+                else
+                    glVertexAttribPointer(location, input.components, GL_FLOAT, GL_FALSE, layout.stride, offset);
+                glVertexAttribDivisor(location, 1);
+            }
+        }
+        for (auto &entry : entries) {
+            glDrawElementsInstancedBaseVertex(drawMode, entry.nrIndices, GL_UNSIGNED_INT,
+                                              (void *)(sizeof(unsigned int) * entry.baseIndex),
+                                              batch.count, entry.baseVertex);
+            ++stats.draws;
+        }
+        stats.instances += batch.count;
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    items.clear();
+    keys.clear();
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "core/gpu/mesh.h"
+#include "core/gpu/shader.h"
+#include "material.h"
+#include "utils/glm_utils.h"
+
+// opaque gameobjects go first, closest first, so the depth test throws away as much as
+// it can of what's behind them
+#define RENDER_PASS_OPAQUE 0
+// big things that are behind everything else anyway, like the skybox. Drawn after the
+// opaque pass, so only what's still uncovered gets shaded
+#define RENDER_PASS_BACKGROUND 1
+// last, farthest first, so they blend over what's behind them
+#define RENDER_PASS_TRANSPARENT 2
+
+namespace engine
+{
+    // The draws for one camera, sorted so the GL state changes as little as possible
+    // between them. Each draw gets a 64 bit key, from the most significant bits:
+    //     pass (2) | program (10) | texture (10) | mesh VAO (10) | depth (32)
+    // so draws with the same shader end up together, among those the ones with the same
+    // texture, and so on; the depth only orders draws that share everything else. The
+    // transparent pass has to be drawn back to front instead, so its keys are
+    //     pass (2) | inverted depth (32) | program (10) | texture (10) | mesh VAO (10)
+    // and the state only groups draws at the same depth. GL ids are small in practice,
+    // one that doesn't fit only gets sorted a bit worse.
+    // Submit then only binds what differs from the previous draw.
+    //
+    // Shaders that take the model matrix as a vertex input, mat4 WIST_MODEL_MATRIX at
+    // WIST_FIRST_INSTANCE_LOCATION or after, are drawn instanced: neighbouring draws of
+    // the same mesh with materials that only differ in per instance parameters become
+    // one draw call, and their model matrices and parameters go in an instance buffer.
+    // Shaders with a WIST_MODEL_MATRIX uniform are drawn one by one
+    class RenderQueue
+    {
+    public:
+        struct Stats {
+            size_t draws = 0;          // draw calls
+            size_t instances = 0;      // meshes drawn, so draws for shaders that aren't instanced
+            size_t programBinds = 0;
+            size_t materialBinds = 0;  // Material::Apply calls, which skip what's unchanged
+            size_t meshBinds = 0;      // VAO binds
+            // filled in by the scene, which culls before queueing
+            size_t visible = 0;        // gameobjects queued
+            size_t culled = 0;         // gameobjects outside the camera's frustum
+        };
+
+        ~RenderQueue();
+
+        // material may be nullptr, to draw with just the shader. depth is the distance
+        // along the camera's forward direction
+        void Add(int pass, Mesh *mesh, Shader *shader, const Material *material,
+                 const glm::mat4 &modelMatrix, float depth);
+        // draws everything in order and empties the queue. viewProjection is for the
+        // shaders that use WIST_MVP
+        void Submit(const glm::mat4 &viewProjection, Stats &stats);
+
+    private:
+        struct Item {
+            Mesh *mesh;
+            Shader *shader;
+            const Material *material;
+            glm::mat4 modelMatrix;
+        };
+        // neighbouring items, in key order, that are drawn with one call
+        struct Batch {
+            uint32_t first;
+            uint32_t count;
+            size_t instanceOffset;  // in bytes, into the instance buffer
+        };
+        // where each per instance input of a program goes in the instance buffer
+        struct InstanceInput {
+            GLint location;
+            int columns;     // locations taken, 4 for a mat4
+            int components;  // per column
+            bool integer;
+            uint32_t offset;
+        };
+        struct InstanceLayout {
+            bool instanced = false;
+            uint32_t stride = 0;
+            std::vector<InstanceInput> inputs;  // the model matrix is the first one
+        };
+
+        const InstanceLayout &GetLayout(Shader *shader);
+        bool CanShareBatch(const Item &a, const Item &b) const;
+        void WriteInstance(const Item &item, const InstanceLayout &layout);
+
+        // kept between frames so they don't allocate; the keys are sorted instead of the
+        // items, which are much bigger
+        std::vector<Item> items;
+        std::vector<std::pair<uint64_t, uint32_t>> keys;
+        std::vector<Batch> batches;
+        std::vector<uint8_t> instanceData;
+        GLuint instanceBuffer = 0;
+        size_t instanceBufferSize = 0;
+        // by program; the programs aren't relinked while the game runs
+        std::unordered_map<GLuint, InstanceLayout> layouts;
+    };
+}
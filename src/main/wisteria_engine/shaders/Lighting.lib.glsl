@@ -1,6 +1,11 @@
 uniform float WIST_SCENE_AMBIENT;
 uniform vec4 WIST_LIGHTS[8];
-uniform vec4 WIST_EYE_POSITION;
+layout(std140) uniform WIST_CAMERA
+{
+    mat4 WIST_VIEW_MATRIX;
+    mat4 WIST_PROJECTION_MATRIX;
+    vec4 WIST_EYE_POSITION;
+};
 
 uniform float WIST_MATERIAL_AMBIENT;
 uniform float WIST_MATERIAL_DIFFUSE;
@@ -7,11 +7,16 @@ layout(location = 1) in vec3 v_normal;
 layout(location = 2) in vec2 v_texture_coord;
 layout(location = 3) in vec3 v_color;
 
-uniform mat4 WIST_MODEL_MATRIX;
-uniform mat4 WIST_VIEW_MATRIX;
-uniform mat4 WIST_PROJECTION_MATRIX;
+// per instance, from the render queue's instance buffer
+layout(location = 4) in mat4 WIST_MODEL_MATRIX;
+layout(location = 8) in mat3 UV_TRANSFORM;
 
-uniform mat3 UV_TRANSFORM;
+layout(std140) uniform WIST_CAMERA
+{
+    mat4 WIST_VIEW_MATRIX;
+    mat4 WIST_PROJECTION_MATRIX;
+    vec4 WIST_EYE_POSITION;
+};
 
 out vec3 frag_normal;
 out vec3 frag_color;
@@ -0,0 +1,59 @@
+#include <new>
+#include "slaballocator.h"
+
+using namespace engine;
+
+SlabAllocator::~SlabAllocator()
+{
+    for (auto slab : slabs)
+        ::operator delete(slab);
+}
+
+void *SlabAllocator::Allocate(size_t size)
+{
+    ++stats.allocations;
+    size_t sizeClass = (size + SLAB_ALIGNMENT - 1) / SLAB_ALIGNMENT;
+    if (sizeClass > SLAB_MAX_CLASS) {
+        ++stats.largeAllocations;
+        return ::operator new(size);
+    }
+
+    if (freeLists[sizeClass] == nullptr)
+        AddSlab(sizeClass);
+    else
+        ++stats.reused;
+    FreeBlock *block = freeLists[sizeClass];
+    freeLists[sizeClass] = block->next;
+    return block;
+}
+
+void SlabAllocator::Free(void *block, size_t size)
+{
+    if (block == nullptr)
+        return;
+    ++stats.frees;
+    size_t sizeClass = (size + SLAB_ALIGNMENT - 1) / SLAB_ALIGNMENT;
+    if (sizeClass > SLAB_MAX_CLASS) {
+        ::operator delete(block);
+        return;
+    }
+
+    FreeBlock *freeBlock = (FreeBlock *)block;
+    freeBlock->next = freeLists[sizeClass];
+    freeLists[sizeClass] = freeBlock;
+}
+
+void SlabAllocator::AddSlab(size_t sizeClass)
+{
+    size_t blockSize = sizeClass * SLAB_ALIGNMENT;
+    char *slab = (char *)::operator new(blockSize * SLAB_BLOCKS);
+    slabs.push_back(slab);
+    ++stats.slabs;
+
+    // in address order, so the first objects end up next to each other
+    for (int block = SLAB_BLOCKS - 1; block >= 0; --block) {
+        FreeBlock *freeBlock = (FreeBlock *)(slab + block * blockSize);
+        freeBlock->next = freeLists[sizeClass];
+        freeLists[sizeClass] = freeBlock;
+    }
+}
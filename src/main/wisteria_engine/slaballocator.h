@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#define SLAB_ALIGNMENT 16     // block sizes are multiples of this
+#define SLAB_MAX_CLASS 64     // so blocks up to 1KB; bigger objects go to the system allocator
+#define SLAB_BLOCKS 32        // blocks per slab
+
+namespace engine
+{
+    // Memory for one family of types (say, GameObject and all its subclasses), handed out
+    // from slabs of same-sized blocks, one free list per size. Freed blocks are kept for
+    // the next object of the same size, so once there are enough slabs, spawning and
+    // destroying objects doesn't go to the system allocator anymore.
+    // Slabs are only given back when the allocator is destroyed. Not thread safe.
+    class SlabAllocator
+    {
+    public:
+        struct Stats {
+            size_t allocations = 0;       // blocks handed out
+            size_t frees = 0;             // blocks given back
+            size_t reused = 0;            // allocations served by a freed block
+            size_t slabs = 0;             // slabs taken from the system allocator
+            size_t largeAllocations = 0;  // too big for a block, taken from the system allocator
+
+            size_t Live() const { return allocations - frees; }
+        };
+
+        SlabAllocator() = default;
+        SlabAllocator(const SlabAllocator &) = delete;
+        SlabAllocator &operator=(const SlabAllocator &) = delete;
+        ~SlabAllocator();
+
+        void *Allocate(size_t size);
+        // size must be the one given to Allocate
+        void Free(void *block, size_t size);
+
+        const Stats &GetStats() const { return stats; }
+
+    private:
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        void AddSlab(size_t sizeClass);
+
+        FreeBlock *freeLists[SLAB_MAX_CLASS + 1] = {};
+        std::vector<void *> slabs;
+        Stats stats;
+    };
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#define NULL_HANDLE_INDEX UINT32_MAX
+
+namespace engine
+{
+    // Refers to a value in a SlotMap. Slots are reused, but every reuse bumps the slot's
+    // generation, so a handle to something that was removed stays invalid for good and
+    // can be kept around instead of a pointer that could dangle
+    struct Handle
+    {
+        uint32_t index = NULL_HANDLE_INDEX;
+        uint32_t generation = 0;
+
+        bool IsNull() const { return index == NULL_HANDLE_INDEX; }
+        bool operator==(const Handle &other) const
+        {
+            return index == other.index && generation == other.generation;
+        }
+        bool operator!=(const Handle &other) const { return !(*this == other); }
+    };
+
+    // Values packed in one array for iteration, plus a table of slots that handles index
+    // into. Insert, Remove and Get are all O(1); Remove moves the last value into the
+    // hole, so the order of the values changes
+    template <typename T>
+    class SlotMap
+    {
+    public:
+        Handle Insert(const T &value)
+        {
+            uint32_t index;
+            if (freeSlots.empty()) {
+                index = (uint32_t)slots.size();
+                slots.push_back({1, 0});
+            } else {
+                index = freeSlots.back();
+                freeSlots.pop_back();
+            }
+            slots[index].value = (uint32_t)values.size();
+            values.push_back(value);
+            valueSlots.push_back(index);
+            return {index, slots[index].generation};
+        }
+
+        // false if the handle was already invalid
+        bool Remove(Handle handle)
+        {
+            if (!Contains(handle))
+                return false;
+            Slot &slot = slots[handle.index];
+            uint32_t last = valueSlots.back();
+            values[slot.value] = values.back();
+            valueSlots[slot.value] = last;
+            slots[last].value = slot.value;
+            values.pop_back();
+            valueSlots.pop_back();
+
+            ++slot.generation;
+            freeSlots.push_back(handle.index);
+            return true;
+        }
+
+        bool Contains(Handle handle) const
+        {
+            return handle.index < slots.size() && slots[handle.index].generation == handle.generation;
+        }
+
+        // nullptr if the handle is invalid
+        T *Get(Handle handle)
+        {
+            return Contains(handle) ? &values[slots[handle.index].value] : nullptr;
+        }
+
+        void Clear()
+        {
+            for (uint32_t value = 0; value < valueSlots.size(); ++value) {
+                ++slots[valueSlots[value]].generation;
+                freeSlots.push_back(valueSlots[value]);
+            }
+            values.clear();
+            valueSlots.clear();
+        }
+
+        void Reserve(size_t count)
+        {
+            slots.reserve(count);
+            values.reserve(count);
+            valueSlots.reserve(count);
+            freeSlots.reserve(count);
+        }
+
+        size_t Size() const { return values.size(); }
+        typename std::vector<T>::iterator begin() { return values.begin(); }
+        typename std::vector<T>::iterator end() { return values.end(); }
+        typename std::vector<T>::const_iterator begin() const { return values.begin(); }
+        typename std::vector<T>::const_iterator end() const { return values.end(); }
+
+    private:
+        struct Slot
+        {
+            uint32_t generation;
+            uint32_t value;  // where the value is in values, while the slot is used
+        };
+
+        std::vector<Slot> slots;
+        std::vector<uint32_t> freeSlots;
+        std::vector<T> values;
+        std::vector<uint32_t> valueSlots;  // the slot of each value
+    };
+}
@@ -0,0 +1,43 @@
+#include <iostream>
+#include "tags.h"
+
+using namespace engine;
+
+std::unordered_map<std::string, int> &Tags::Ids()
+{
+    static std::unordered_map<std::string, int> ids;
+    return ids;
+}
+
+std::vector<std::string> &Tags::Names()
+{
+    static std::vector<std::string> names;
+    return names;
+}
+
+int Tags::Id(const std::string &name)
+{
+    auto found = Ids().find(name);
+    if (found != Ids().end())
+        return found->second;
+
+    int id = (int)Names().size();
+    if (id >= MAX_TAGS) {
+        std::cerr << "Wisteria Engine only supports " << MAX_TAGS << " tags.\n";
+        exit(1);
+    }
+    Ids().emplace(name, id);
+    Names().push_back(name);
+    return id;
+}
+
+int Tags::Find(const std::string &name)
+{
+    auto found = Ids().find(name);
+    return found == Ids().end() ? -1 : found->second;
+}
+
+const std::string &Tags::Name(int id)
+{
+    return Names()[id];
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#define MAX_TAGS 64
+
+namespace engine
+{
+    typedef uint64_t TagMask;
+
+    // Interns tag names to small ids, given in the order the names are first seen, so a
+    // gameobject can keep its tags as the bits of a TagMask and checking for a tag is
+    // an AND instead of a string compare. Look the ids up once and keep them around
+    class Tags
+    {
+    public:
+        // the id of name, registered the first time it is asked for
+        static int Id(const std::string &name);
+        // the id of name, or -1 if it was never registered
+        static int Find(const std::string &name);
+        static const std::string &Name(int id);
+        static TagMask Mask(int id) { return (TagMask)1 << id; }
+
+    private:
+        // function statics, so tags can be registered from static initializers
+        static std::unordered_map<std::string, int> &Ids();
+        static std::vector<std::string> &Names();
+    };
+}
@@ -1,5 +1,10 @@
 #include "transform3d.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WIST_AFFINE_SSE
+#include <emmintrin.h>
+#endif
+
 using namespace engine;
 
 glm::mat4 transform::Translate(float translateX, float translateY, float translateZ)
@@ -53,3 +58,49 @@ glm::mat4 transform::RotateOZ(float radians)
 }
 
 
+
+glm::mat4 transform::TRS(glm::vec3 translation, glm::quat rotation, glm::vec3 scale)
+{
+    glm::mat3 r = glm::mat3_cast(rotation);
+    return glm::mat4(
+        glm::vec4(r[0] * scale.x, 0),
+        glm::vec4(r[1] * scale.y, 0),
+        glm::vec4(r[2] * scale.z, 0),
+        glm::vec4(translation, 1)
+    );
+}
+
+glm::mat4 transform::MultiplyAffine(const glm::mat4 &a, const glm::mat4 &b)
+{
+    glm::mat4 result;
+#ifdef WIST_AFFINE_SSE
+    // SSE2 is part of x86-64, so this needs no runtime check. Columns of a, scaled by
+    // the x, y and z of each column of b; the w of b's columns is 0, except for the
+    // translation, where it is 1
+    __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    __m128 a3 = _mm_loadu_ps(&a[3][0]);
+    for (int column = 0; column < 4; ++column) {
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[column][0])),
+                                         _mm_mul_ps(a1, _mm_set1_ps(b[column][1]))),
+                              _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+        if (column == 3)
+            r = _mm_add_ps(r, a3);
+        _mm_storeu_ps(&result[column][0], r);
+    }
+#else
+    for (int column = 0; column < 4; ++column)
+        result[column] = a[0] * b[column][0] + a[1] * b[column][1] + a[2] * b[column][2];
+    result[3] += a[3];
+#endif
+    return result;
+}
+
+glm::mat4 transform::InverseAffine(const glm::mat4 &matrix)
+{
+    glm::mat3 inverse = glm::inverse(glm::mat3(matrix));
+    glm::mat4 result = glm::mat4(inverse);
+    result[3] = glm::vec4(-(inverse * glm::vec3(matrix[3])), 1);
+    return result;
+}
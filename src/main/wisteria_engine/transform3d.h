@@ -12,4 +12,16 @@ namespace engine::transform
     glm::mat4 RotateOX(float radians);
     glm::mat4 RotateOY(float radians);
     glm::mat4 RotateOZ(float radians);
-}
\ No newline at end of file
+
+    // The following are for affine matrices, whose last row is (0, 0, 0, 1), which is
+    // all the transforms of the gameobjects. They skip what that row makes trivial.
+
+    // the same as Translate(translation) * Rotate(rotation) * Scale(scale), written
+    // out directly: the rotation matrix of the quaternion with its columns scaled
+    glm::mat4 TRS(glm::vec3 translation, glm::quat rotation, glm::vec3 scale);
+    // a * b, for affine a and b. Uses SSE where it can
+    glm::mat4 MultiplyAffine(const glm::mat4 &a, const glm::mat4 &b);
+    // the inverse of an affine matrix: the inverse of the 3x3 part and the translation
+    // taken back through it
+    glm::mat4 InverseAffine(const glm::mat4 &matrix);
+}
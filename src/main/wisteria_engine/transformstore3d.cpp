@@ -0,0 +1,202 @@
+#include <algorithm>
+#include "transformstore3d.h"
+#include "gameobject3d.h"
+#include "transform3d.h"
+
+using namespace engine;
+
+int TransformStore::Add(GameObject *owner, int parent, glm::vec3 localPosition,
+                        glm::vec3 localScale, glm::quat localRotation)
+{
+    // the parent exists already, so appending keeps it first
+    int index = (int)owners.size();
+    owners.push_back(owner);
+    parents.push_back(parent);
+    dirty.push_back(true);
+    localPositions.push_back(localPosition);
+    localRotations.push_back(localRotation);
+    localScales.push_back(localScale);
+    positions.push_back(localPosition);
+    rotations.push_back(localRotation);
+    pseudoScales.push_back(localScale);
+    matrices.push_back(glm::mat4(1));
+    stepTranslations.push_back(glm::vec3(0));
+    stepRotations.push_back(QUAT1);
+    interpolated.push_back(false);
+    renderMatrices.push_back(glm::mat4(1));
+    renderBounds.push_back(glm::vec4(0, 0, 0, -1));
+    return index;
+}
+
+void TransformStore::Remove(int index)
+{
+    // the hole is closed at the next Update
+    owners[index] = nullptr;
+    parents[index] = -1;
+    dirty[index] = false;
+    needsReorder = true;
+}
+
+void TransformStore::SetParent(int index, int parent)
+{
+    parents[index] = parent;
+    if (parent > index)
+        needsReorder = true;
+}
+
+void TransformStore::ResolveChain(int index)
+{
+    int parent = parents[index];
+    if (parent != -1)
+        Resolve(parent);
+    Calculate(index);
+}
+
+void TransformStore::Update()
+{
+    if (needsReorder)
+        Reorder();
+
+    // parents come first, so they are always resolved by the time their children are.
+    // Size is read every time, in case OnTransformChange makes new gameobjects
+    for (size_t index = 0; index < owners.size(); ++index)
+        if (dirty[index])
+            Calculate((int)index);
+}
+
+void TransformStore::SetStepMotion(int index, glm::vec3 translation, glm::quat rotation)
+{
+    stepTranslations[index] = translation;
+    stepRotations[index] = rotation;
+}
+
+void TransformStore::ClearStepMotion()
+{
+    std::fill(stepTranslations.begin(), stepTranslations.end(), glm::vec3(0));
+    std::fill(stepRotations.begin(), stepRotations.end(), QUAT1);
+}
+
+void TransformStore::UpdateRenderMatrices(float alpha)
+{
+    Update();
+
+    // the step is undone by 1 - alpha; whatever didn't move in it, and has no parent
+    // that did, is drawn where it is
+    float rewind = 1 - alpha;
+    for (size_t index = 0; index < owners.size(); ++index) {
+        int parent = parents[index];
+        bool moved = stepTranslations[index] != glm::vec3(0) || stepRotations[index] != QUAT1;
+        interpolated[index] = moved || (parent != -1 && interpolated[parent]);
+        if (!interpolated[index]) {
+            renderMatrices[index] = matrices[index];
+        } else {
+            glm::vec3 position = localPositions[index] - rewind * stepTranslations[index];
+            glm::quat rotation = localRotations[index] *
+                glm::slerp(QUAT1, glm::conjugate(stepRotations[index]), rewind);
+            glm::mat4 local = transform::TRS(position, rotation, localScales[index]);
+            renderMatrices[index] = parent == -1 ? local : transform::MultiplyAffine(renderMatrices[parent], local);
+        }
+
+        // the mesh can be swapped at any time, so this isn't cached with the matrix
+        Mesh *mesh = owners[index]->mesh;
+        if (mesh == nullptr || mesh->boundingSphereRadius < 0) {
+            renderBounds[index] = glm::vec4(0, 0, 0, -1);
+            continue;
+        }
+        const glm::mat4 &matrix = renderMatrices[index];
+        // the sphere grows with the largest scale along any axis
+        float scale2 = glm::max(glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+                                glm::max(glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1])),
+                                         glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))));
+        glm::vec3 center = glm::vec3(matrix * glm::vec4(mesh->boundingSphereCenter, 1));
+        renderBounds[index] = glm::vec4(center, mesh->boundingSphereRadius * glm::sqrt(scale2));
+    }
+}
+
+void TransformStore::Calculate(int index)
+{
+    GameObject *owner = owners[index];
+    int parent = parents[index];
+    glm::vec3 parentPosition = glm::vec3(0);
+    glm::quat parentRotation = QUAT1;
+    glm::vec3 parentScale = glm::vec3(1);
+    if (parent != -1) {
+        parentPosition = positions[parent];
+        parentRotation = rotations[parent];
+        parentScale = pseudoScales[parent];
+    }
+
+    positions[index] = parentPosition + parentRotation * (parentScale * localPositions[index]);
+    // fixedRotation objects keep their world rotation instead of their local one
+    if (owner->fixedRotation)
+        localRotations[index] = glm::conjugate(parentRotation) * rotations[index];
+    else
+        rotations[index] = parentRotation * localRotations[index];
+    pseudoScales[index] = localScales[index] * parentScale;
+
+    glm::mat4 local = transform::TRS(localPositions[index], localRotations[index], localScales[index]);
+    matrices[index] = parent == -1 ? local : transform::MultiplyAffine(matrices[parent], local);
+    if (owner->hitArea != nullptr)
+        owner->hitArea->Refit(positions[index], rotations[index], pseudoScales[index]);
+
+    dirty[index] = false;
+    // last, since it may add transforms and move the arrays
+    owner->OnTransformChange();
+}
+
+template <typename T>
+static void Permute(std::vector<T> &values, const std::vector<int> &order, std::vector<T> &scratch)
+{
+    scratch.clear();
+    for (int index : order)
+        scratch.push_back(values[index]);
+    values.swap(scratch);
+}
+
+void TransformStore::Reorder()
+{
+    needsReorder = false;
+
+    // depth first from every root, so each subtree also ends up in one piece
+    order.clear();
+    for (size_t root = 0; root < owners.size(); ++root) {
+        if (owners[root] == nullptr || parents[root] != -1)
+            continue;
+        stack.clear();
+        stack.push_back((int)root);
+        while (!stack.empty()) {
+            int index = stack.back();
+            stack.pop_back();
+            order.push_back(index);
+            auto &children = owners[index]->GetChildren();
+            for (auto child = children.rbegin(); child != children.rend(); ++child)
+                stack.push_back((*child)->transformIndex);
+        }
+    }
+
+    remap.assign(owners.size(), -1);
+    for (size_t newIndex = 0; newIndex < order.size(); ++newIndex)
+        remap[order[newIndex]] = (int)newIndex;
+
+    Permute(owners, order, scratchOwners);
+    Permute(parents, order, scratchInts);
+    Permute(dirty, order, scratchFlags);
+    Permute(localPositions, order, scratchVec3s);
+    Permute(localRotations, order, scratchQuats);
+    Permute(localScales, order, scratchVec3s);
+    Permute(positions, order, scratchVec3s);
+    Permute(rotations, order, scratchQuats);
+    Permute(pseudoScales, order, scratchVec3s);
+    Permute(matrices, order, scratchMat4s);
+    Permute(stepTranslations, order, scratchVec3s);
+    Permute(stepRotations, order, scratchQuats);
+    Permute(interpolated, order, scratchFlags);
+    Permute(renderMatrices, order, scratchMat4s);
+    Permute(renderBounds, order, scratchVec4s);
+
+    for (size_t index = 0; index < owners.size(); ++index) {
+        owners[index]->transformIndex = (int)index;
+        if (parents[index] != -1)
+            parents[index] = remap[parents[index]];
+    }
+}
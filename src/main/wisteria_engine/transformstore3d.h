@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "utils/glm_utils.h"
+
+namespace engine
+{
+    class GameObject;
+
+    // The transforms of all the gameobjects, in flat arrays (one per field) ordered so
+    // that a parent always comes before its children. A gameobject only keeps its index
+    // in here; the world transforms can then be calculated in one pass over the arrays.
+    // Indices change when the arrays are compacted or reordered, which only happens in
+    // Update, and the gameobjects are told about it
+    class TransformStore
+    {
+    public:
+        int Add(GameObject *owner, int parent, glm::vec3 localPosition, glm::vec3 localScale,
+                glm::quat localRotation);
+        void Remove(int index);
+        void SetParent(int index, int parent);
+
+        // calculates the world transform of index and of its dirty ancestors
+        void Resolve(int index)
+        {
+            if (dirty[index])
+                ResolveChain(index);
+        }
+        // calculates every dirty world transform, in order. Hitareas are refit
+        // along with the transform of their gameobject
+        void Update();
+
+        // the local motion of the last simulation step, which rendering interpolates over
+        void SetStepMotion(int index, glm::vec3 translation, glm::quat rotation);
+        void ClearStepMotion();
+        // calculates renderMatrices: the world matrices as they were alpha of the way
+        // through the last simulation step, 0 being its start and 1 its end. And
+        // renderBounds with them
+        void UpdateRenderMatrices(float alpha);
+
+        size_t Size() const { return owners.size(); }
+
+        std::vector<GameObject *> owners;  // nullptr for removed transforms, until Update
+        std::vector<int> parents;          // -1 for roots
+        std::vector<uint8_t> dirty;        // if set, it is set for the whole subtree too
+        std::vector<glm::vec3> localPositions;
+        std::vector<glm::quat> localRotations;
+        std::vector<glm::vec3> localScales;
+        std::vector<glm::vec3> positions;
+        std::vector<glm::quat> rotations;
+        std::vector<glm::vec3> pseudoScales;
+        std::vector<glm::mat4> matrices;
+        std::vector<glm::vec3> stepTranslations;
+        std::vector<glm::quat> stepRotations;
+        std::vector<uint8_t> interpolated;  // moved in the last step, or has a parent that did
+        std::vector<glm::mat4> renderMatrices;
+        // the bounding sphere of the owner's mesh around renderMatrices, as (center,
+        // radius); the radius is negative if there is no mesh or it has no bounds
+        std::vector<glm::vec4> renderBounds;
+
+    private:
+        void ResolveChain(int index);
+        void Calculate(int index);
+        void Reorder();
+
+        // removed transforms or a child before its parent
+        bool needsReorder = false;
+
+        // kept between reorders so they don't allocate
+        std::vector<int> order, remap, stack;
+        std::vector<GameObject *> scratchOwners;
+        std::vector<int> scratchInts;
+        std::vector<uint8_t> scratchFlags;
+        std::vector<glm::vec3> scratchVec3s;
+        std::vector<glm::vec4> scratchVec4s;
+        std::vector<glm::quat> scratchQuats;
+        std::vector<glm::mat4> scratchMat4s;
+    };
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include "workerpool.h"
+
+using namespace engine;
+
+WorkerPool::WorkerPool(int threadCount)
+{
+    if (threadCount <= 0) {
+        int cores = (int)std::thread::hardware_concurrency();
+        threadCount = std::clamp(cores, 1, WORKER_POOL_MAX_THREADS);
+    }
+    this->threadCount = threadCount;
+    threads.reserve(threadCount - 1);
+    for (int worker = 1; worker < threadCount; ++worker)
+        threads.emplace_back(&WorkerPool::WorkerLoop, this, worker);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &thread : threads)
+        thread.join();
+}
+
+void WorkerPool::Run(size_t count, size_t minPerWorker, const Task &task)
+{
+    if (count == 0)
+        return;
+    size_t wanted = (count + minPerWorker - 1) / std::max<size_t>(minPerWorker, 1);
+    int chunks = (int)std::clamp<size_t>(wanted, 1, threadCount);
+    if (chunks == 1) {
+        task(0, 0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        this->count = count;
+        this->chunks = chunks;
+        pending = chunks - 1;
+        ++generation;
+    }
+    wake.notify_all();
+
+    task(0, 0, count / chunks);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return pending == 0; });
+    this->task = nullptr;
+}
+
+void WorkerPool::WorkerLoop(int worker)
+{
+    unsigned seen = 0;
+    while (true) {
+        const Task *task;
+        size_t count;
+        int chunks;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            task = this->task;
+            count = this->count;
+            chunks = this->chunks;
+        }
+        // workers past the last chunk have nothing to do this time, and Run doesn't wait for them
+        if (worker >= chunks)
+            continue;
+
+        (*task)(worker, count * worker / chunks, count * (worker + 1) / chunks);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0)
+            done.notify_one();
+    }
+}
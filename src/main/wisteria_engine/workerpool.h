@@ -0,0 +1,47 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define WORKER_POOL_MAX_THREADS 8
+
+namespace engine
+{
+    // A fixed set of threads that split a range of indices between them. The thread that
+    // calls Run takes part in the work and Run only returns once the whole range is done,
+    // so the task can use anything the caller can.
+    // The range is always split the same way for a given thread count: worker i gets the
+    // i-th contiguous chunk.
+    class WorkerPool
+    {
+    public:
+        typedef std::function<void(int worker, size_t begin, size_t end)> Task;
+
+        // threadCount counts the calling thread too; 0 means one per core, up to
+        // WORKER_POOL_MAX_THREADS
+        explicit WorkerPool(int threadCount = 0);
+        ~WorkerPool();
+
+        int GetThreadCount() const { return threadCount; }
+        // calls task on chunks of [0, count) of at least minPerWorker indices, so small
+        // ranges don't pay for waking up threads
+        void Run(size_t count, size_t minPerWorker, const Task &task);
+
+    private:
+        void WorkerLoop(int worker);
+
+        int threadCount;
+        std::vector<std::thread> threads;
+
+        std::mutex mutex;
+        std::condition_variable wake, done;
+        const Task *task = nullptr;
+        size_t count = 0;
+        int chunks = 0;
+        int pending = 0;
+        unsigned generation = 0;  // bumped by every Run, so the workers know there's work
+        bool stopping = false;
+    };
+}